@@ -4,6 +4,7 @@
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 
 #include <iostream>
+#include <iomanip>
 #include <stdexcept>
 #include <functional>
 #include <cstdlib>
@@ -17,33 +18,75 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 // Constructor
-Application::Application() {
-	InitWindow();
+Application::Application(const ApplicationConfig& config) : m_Config(config), m_Window(nullptr), m_Surface(VK_NULL_HANDLE), m_PresentModePolicy(config.presentMode) {
+	if (!m_Config.headless) {
+		InitWindow();
+	}
+	CreateFramePacer();
 	InitVulkan();
 }
 
 // Destructor
 Application::~Application() {
+	// Destroy objects retired by swap chain recreation
+	QueueTimeline* timeline = m_Device->GetGraphicsTimeline();
+	timeline->Wait(timeline->GetLastSubmittedValue());
+	timeline->CollectGarbage();
+
+	// Compiles still queued use the render graphs' render passes
+	m_PipelineLibrary->WaitIdle();
+	CollectRenderGraphs(true);
 
 	// Clean up swapchain
 	CleanupSwapChain();
+	CleanupImageResources();
+
+	// Delete pipeline library with its pipelines, then the shaders they were compiled from
+	delete(m_PipelineLibrary);
+	delete(m_Shader);
+	delete(m_ShaderLibrary);
+
+	// Delete descriptor cache with its pools
+	delete(m_DescriptorCache);
+
+	// Delete layout cache with the descriptor set and pipeline layouts, then the bindless table
+	delete(m_LayoutCache);
+	delete(m_BindlessTextures);
+
+	// Delete pipeline cache, saving it for the next run
+	delete(m_PipelineCache);
 
 	// Destroy sampler
 	vkDestroySampler(m_Device->GetDevice(), m_TextureSampler, nullptr);
 
-	// Destroy descriptor set layout
-	vkDestroyDescriptorSetLayout(m_Device->GetDevice(), m_DescriptorSetLayout, nullptr);
+	// Delete dynamic resolution timestamps
+	delete(m_DynamicResolution);
+
+	// Delete defragmenter, destroying resources it has retired
+	delete(m_Defragmenter);
 
 	// Delete model
 	delete(m_Model);
 
 	// Destroy semaphores
-	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+	for (size_t i = 0; i < m_Config.framesInFlight; i++) {
 		vkDestroySemaphore(m_Device->GetDevice(), m_RenderFinishedSemaphores[i], nullptr);
 		vkDestroySemaphore(m_Device->GetDevice(), m_ImageAvailableSemaphores[i], nullptr);
-		vkDestroyFence(m_Device->GetDevice(), m_InFlightFences[i], nullptr);
 	}
 
+	// Destroy per frame command pools, freeing their command buffers
+	for (CommandPool* frameCommandPool : m_FrameCommandPools) {
+		delete(frameCommandPool);
+	}
+
+	// Destroy recording command pools
+	for (CommandPool* threadCommandPool : m_ThreadCommandPools) {
+		delete(threadCommandPool);
+	}
+
+	// Stop recording workers
+	delete(m_JobSystem);
+
 	// Destroy command pool
 	delete(m_CommandPool);
 
@@ -55,35 +98,92 @@ Application::~Application() {
 		DestroyDebugUtilsMessengerEXT(m_Instance, m_DebugMessenger, nullptr);
 	}
 
-	// Destroy vulkan surface
+	// Destroy vulkan surface, null when headless
 	vkDestroySurfaceKHR(m_Instance, m_Surface, nullptr);
 
 	// Destroy vulkan instance
 	vkDestroyInstance(m_Instance, nullptr);
 
-	// Destroy window
-	glfwDestroyWindow(m_Window);
+	// Delete frame pacer
+	delete(m_FramePacer);
 
-	// Terminate GLFW
-	glfwTerminate();
+	// Destroy window and terminate GLFW, never initialised when headless
+	if (!m_Config.headless) {
+		glfwDestroyWindow(m_Window);
+		glfwTerminate();
+	}
 }
 
 // Run application
 void Application::Run() {
 
-	// Loop while not closing window
-	while (!glfwWindowShouldClose(m_Window)) {
+	// Time of last memory usage log
+	auto lastMemoryLog = std::chrono::high_resolution_clock::now();
+	auto runStart = lastMemoryLog;
+	uint32_t frames = 0;
+
+	// Loop while not closing window or until frame count is reached
+	while ((m_Window == nullptr || !glfwWindowShouldClose(m_Window)) && (m_Config.frameCount == 0 || frames < m_Config.frameCount)) {
+		// Wait for the latest moment to start the frame
+		m_FramePacer->WaitForFrameStart();
 		// Poll for events
-		glfwPollEvents();
+		if (m_Window != nullptr) {
+			glfwPollEvents();
+		}
 		// Draw frame
 		DrawFrame();
+		m_FramePacer->EndFrame();
+		frames++;
+
+		// Periodically log memory usage and budget
+		auto currentTime = std::chrono::high_resolution_clock::now();
+		if (std::chrono::duration<double>(currentTime - lastMemoryLog).count() >= MEMORY_LOG_INTERVAL) {
+			m_Device->GetAllocator()->LogUsage();
+			LogLatency();
+			m_FramePacer->LogStats();
+			if (m_DynamicResolution != nullptr) {
+				m_DynamicResolution->LogStats();
+			}
+			m_DescriptorCache->LogStats();
+			lastMemoryLog = currentTime;
+		}
 	}
 
 	// Wait for device to finish before exiting
 	vkDeviceWaitIdle(m_Device->GetDevice());
+	LogPresentModeStats();
+
+	// Throughput of whole run, the only result of a headless run
+	double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - runStart).count();
+	std::cout << std::fixed << std::setprecision(2) << "Rendered " << frames << " frames in " << seconds << " s (" << frames / seconds << " fps)" << std::defaultfloat << std::endl;
+	LogLatency();
+	m_FramePacer->LogStats();
+	m_DescriptorCache->LogStats();
 
 }
 
+// Run micro benchmarks instead of rendering
+void Application::RunBenchmarks() {
+	Benchmark benchmark(m_Device, m_CommandPool);
+
+	// Buffer upload bandwidth
+	benchmark.RunUploads();
+
+	// Command buffer recording cost, re-records the first swap chain image which is idle here
+	benchmark.RunRecording([this](uint32_t drawCount, uint32_t jobCount) {
+		m_DrawCount = drawCount;
+		RecordStaticBundles(0, jobCount);
+	}, m_JobSystem->GetThreadCount());
+	m_DrawCount = 1;
+	m_StaticBundleDirty[0] = true;
+
+	// Task scheduling overhead and scaling across cores
+	benchmark.RunJobs(m_JobSystem);
+
+	// Wait for device to finish before exiting
+	vkDeviceWaitIdle(m_Device->GetDevice());
+}
+
 // Initialise GLFW and window
 void Application::InitWindow() {
 	// Initialise GLFW
@@ -98,31 +198,59 @@ void Application::InitWindow() {
 	m_Window = glfwCreateWindow(WIDTH, HEIGHT, "Vulkan", nullptr, nullptr);
 	glfwSetWindowUserPointer(m_Window, this);
 
-	// Set callback
+	// Set callbacks
 	glfwSetFramebufferSizeCallback(m_Window, FramebufferResizeCallback);
+	glfwSetKeyCallback(m_Window, KeyCallback);
+}
+
+// Pace to configured frame rate or monitor refresh
+void Application::CreateFramePacer() {
+	double targetFrameRate = m_Config.targetFrameRate;
+
+	// Refresh rate of primary monitor, headless has none
+	if (m_Config.refreshLocked && !m_Config.headless) {
+		GLFWmonitor* monitor = glfwGetPrimaryMonitor();
+		const GLFWvidmode* mode = monitor != nullptr ? glfwGetVideoMode(monitor) : nullptr;
+		if (mode != nullptr && mode->refreshRate > 0) {
+			targetFrameRate = mode->refreshRate;
+		}
+	}
+
+	m_FramePacer = new FramePacer(targetFrameRate);
 }
 
 // Initialise Vulkan
 void Application::InitVulkan() {
 	CreateInstance();
 	SetupDebugMessenger();
-	CreateSurface();
+	if (!m_Config.headless) {
+		CreateSurface();
+	}
 	CreateDevice();
-	CreateSwapChain();
+	CreateCommandPool();
+	CreateDynamicResolution();
+	if (m_Config.headless) {
+		CreateOffscreenImages();
+	}
+	else {
+		CreateSwapChain();
+	}
 	CreateImageViews();
-	CreateRenderPass();
+	LoadShaders();
 	CreateDescriptorSetLayout();
-	CreateGraphicsPipeline();
-	CreateCommandPool();
-	CreateColourResources();
-	CreateDepthResources();
-	CreateFramebuffers();
+	CreateRenderGraph();
+	CreatePipelineCache();
+	CreatePipelineLibrary();
 	LoadModel();
+	CreateDefragmenter();
 	CreateTextureSampler();
+	RegisterTextures();
 	CreateUniformBuffers();
-	CreateDescriptorPool();
+	CreateDescriptorCache();
 	CreateDescriptorSets();
+	CreateGraphicsPipeline();
 	CreateCommandBuffers();
+	CreateStaticBundles();
 	CreateSemaphores();
 }
 
@@ -180,7 +308,7 @@ void Application::CreateDevice(){
 }
 
 // Create Vulkan swap chain
-void Application::CreateSwapChain(){
+void Application::CreateSwapChain(VkSwapchainKHR oldSwapChain){
 	// Query swap chain support details from physical device
 	SwapChainSupportDetails swapChainSupport = m_Device->QuerySwapChainSupport(m_Device->GetPhysicalDevice());
 
@@ -191,6 +319,9 @@ void Application::CreateSwapChain(){
 
 	// Number of frames to request
 	uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
+	if (m_Config.swapChainImages > 0) {
+		imageCount = std::max(m_Config.swapChainImages, swapChainSupport.capabilities.minImageCount);
+	}
 	if (swapChainSupport.capabilities.maxImageCount > 0 && imageCount > swapChainSupport.capabilities.maxImageCount) {
 		imageCount = swapChainSupport.capabilities.maxImageCount;
 	}
@@ -206,6 +337,14 @@ void Application::CreateSwapChain(){
 	createInfo.imageArrayLayers = 1;
 	createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
 
+	// Upscale pass blits into swap chain images
+	if (m_DynamicResolution != nullptr) {
+		if (!(swapChainSupport.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT)) {
+			throw std::runtime_error("Swap chain images cannot be upscaled into for dynamic resolution!");
+		}
+		createInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	}
+
 	// Query queue families for swap chain info
 	QueueFamilyIndices indices = m_Device->FindQueueFamilies(m_Device->GetPhysicalDevice());
 	uint32_t queueFamilyIndices[] = { indices.graphicsFamily.value(), indices.presentFamily.value() };
@@ -225,7 +364,7 @@ void Application::CreateSwapChain(){
 	createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
 	createInfo.presentMode = presentMode;
 	createInfo.clipped = VK_TRUE;
-	createInfo.oldSwapchain = VK_NULL_HANDLE;
+	createInfo.oldSwapchain = oldSwapChain;
 
 	// Create swap chain
 	if (vkCreateSwapchainKHR(m_Device->GetDevice(), &createInfo, nullptr, &m_SwapChain) != VK_SUCCESS) {
@@ -240,6 +379,31 @@ void Application::CreateSwapChain(){
 	// Assign member variables
 	m_SwapChainImageFormat = surfaceFormat.format;
 	m_SwapChainExtent = extent;
+
+	// Report previous present mode before measuring the new one
+	if (presentMode != m_PresentMode) {
+		if (m_PresentMode != VK_PRESENT_MODE_MAX_ENUM_KHR) {
+			LogPresentModeStats();
+		}
+		m_PresentMode = presentMode;
+		m_PresentModeStart = std::chrono::high_resolution_clock::now();
+		std::cout << "Present mode " << GetPresentModeName(m_PresentMode) << " (policy " << GetPresentModePolicyName(m_PresentModePolicy) << ")" << std::endl;
+	}
+}
+
+// Create images rendered to instead of a swap chain when headless
+void Application::CreateOffscreenImages(){
+	// Same format and size a window would get, one image per frame in flight unless configured
+	uint32_t imageCount = m_Config.swapChainImages > 0 ? m_Config.swapChainImages : m_Config.framesInFlight;
+	m_SwapChainImageFormat = VK_FORMAT_B8G8R8A8_UNORM;
+	m_SwapChainExtent = { static_cast<uint32_t>(WIDTH), static_cast<uint32_t>(HEIGHT) };
+
+	// Images can be copied out for readback and upscaled into
+	for (uint32_t i = 0; i < imageCount; i++) {
+		m_OffscreenImages.push_back(new Image(m_Device, m_CommandPool, WIDTH, HEIGHT, 1, VK_SAMPLE_COUNT_1_BIT, m_SwapChainImageFormat, VK_IMAGE_TILING_OPTIMAL,
+			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_IMAGE_ASPECT_COLOR_BIT));
+		m_SwapChainImages.push_back(m_OffscreenImages[i]->GetImage());
+	}
 }
 
 // Recreate Vulkan swapchain (runtime)
@@ -251,64 +415,103 @@ void Application::RecreateSwapChain() {
 		glfwWaitEvents();
 	}
 
-	// Wait for device to be unused
-	vkDeviceWaitIdle(m_Device->GetDevice());
-
-	// Clean up previous swapchain
-	CleanupSwapChain();
+	// Frames in flight keep using the old objects, so nothing waits for the device
+	VkSwapchainKHR oldSwapChain = m_SwapChain;
+	std::vector<ImageView*> oldImageViews = m_SwapChainImageViews;
+	RenderGraph* oldRenderGraph = m_RenderGraph;
+	size_t oldImageCount = m_SwapChainImages.size();
 
-	// Recreate swapchain and everything
-	CreateSwapChain();
+	// Recreate only what depends on the swap chain images and extent
+	CreateSwapChain(oldSwapChain);
 	CreateImageViews();
-	CreateRenderPass();
+	CreateRenderGraph();
+
+	// Viewport is dynamic, the library only compiles a new pipeline if the new render pass is incompatible
 	CreateGraphicsPipeline();
-	CreateColourResources();
-	CreateDepthResources();
-	CreateFramebuffers();
-	CreateUniformBuffers();
-	CreateDescriptorPool();
-	CreateDescriptorSets();
-	CreateCommandBuffers();
-}
 
-// Clean swap chain
-void Application::CleanupSwapChain(){
-	// Delete depth image and imageview
-	delete(m_ColourImage);
-	delete(m_DepthImage);
-	
-	// Destroy framebuffers
-	for (auto framebuffer : m_SwapChainFramebuffers) {
-		vkDestroyFramebuffer(m_Device->GetDevice(), framebuffer, nullptr);
-	}
+	// Old render passes may still be used by queued compiles, which the GPU timeline knows nothing about
+	QueueTimeline* timeline = m_Device->GetGraphicsTimeline();
+	m_RetiredRenderGraphs.push_back({ oldRenderGraph, timeline->GetLastSubmittedValue(), m_PipelineLibrary->GetPendingJobs() });
 
-	// Free command buffers
-	vkFreeCommandBuffers(m_Device->GetDevice(), m_CommandPool->GetCommandPool(), static_cast<uint32_t>(m_CommandBuffers.size()), m_CommandBuffers.data());
+	// Destroy old objects once the last frame using them has finished
+	VkDevice device = m_Device->GetDevice();
+	timeline->DestroyAfter(timeline->GetLastSubmittedValue(), [device, oldSwapChain, oldImageViews]() {
+		for (ImageView* imageView : oldImageViews) {
+			delete(imageView);
+		}
+		vkDestroySwapchainKHR(device, oldSwapChain, nullptr);
+	});
+
+	// Per image resources survive unless the number of images changed
+	if (m_SwapChainImages.size() != oldImageCount) {
+		timeline->Wait(timeline->GetLastSubmittedValue());
+		CleanupImageResources();
+		CreateUniformBuffers();
+		CreateDescriptorSets();
+		CreateStaticBundles();
+	}
+	else {
+		// Bundles reference the old render pass and extent, re-recorded once their image is idle
+		std::fill(m_StaticBundleDirty.begin(), m_StaticBundleDirty.end(), true);
+	}
+}
 
-	// Destroy pipeline
-	vkDestroyPipeline(m_Device->GetDevice(), m_GraphicsPipeline, nullptr);
+// Delete retired render graphs no frame or compile uses anymore, waiting for them if wait is true
+void Application::CollectRenderGraphs(bool wait) {
+	QueueTimeline* timeline = m_Device->GetGraphicsTimeline();
+	for (auto retired = m_RetiredRenderGraphs.begin(); retired != m_RetiredRenderGraphs.end();) {
+		if (wait) {
+			timeline->Wait(retired->timelineValue);
+			for (const JobHandle& compile : retired->compiles) {
+				m_JobSystem->Wait(compile);
+			}
+		}
 
-	// Destroy pipeline layout
-	vkDestroyPipelineLayout(m_Device->GetDevice(), m_PipelineLayout, nullptr);
+		bool finished = timeline->IsComplete(retired->timelineValue) && std::all_of(retired->compiles.begin(), retired->compiles.end(), JobSystem::IsFinished);
+		if (!finished) {
+			++retired;
+			continue;
+		}
+		delete(retired->renderGraph);
+		retired = m_RetiredRenderGraphs.erase(retired);
+	}
+}
 
-	// Destroy render pass
-	vkDestroyRenderPass(m_Device->GetDevice(), m_RenderPass, nullptr);
+// Clean swap chain
+void Application::CleanupSwapChain(){
+	// Delete render graph with its render passes, framebuffers and attachments
+	delete(m_RenderGraph);
 
 	// Destroy all image views
 	for (auto imageView : m_SwapChainImageViews) {
 		delete (imageView);
 	}
 
-	// Destroy swap chain
-	vkDestroySwapchainKHR(m_Device->GetDevice(), m_SwapChain, nullptr);
+	// Destroy swap chain or headless images
+	if (m_Config.headless) {
+		for (Image* offscreenImage : m_OffscreenImages) {
+			delete(offscreenImage);
+		}
+	}
+	else {
+		vkDestroySwapchainKHR(m_Device->GetDevice(), m_SwapChain, nullptr);
+	}
+}
+
+// Destroy uniform buffers, descriptor sets and static bundles of swap chain images
+void Application::CleanupImageResources(){
+	// Free static bundles
+	for (size_t job = 0; job < m_ThreadCommandPools.size(); job++) {
+		m_ThreadCommandPools[job]->FreeCommandBuffers(m_StaticBundles[job]);
+	}
 
 	// Destroy uniform buffers
-	for (size_t i = 0; i < m_SwapChainImages.size(); i++) {
-		delete(m_UniformBuffers[i]);
+	for (Buffer* uniformBuffer : m_UniformBuffers) {
+		delete(uniformBuffer);
 	}
 
-	// Destroy descriptor pool
-	vkDestroyDescriptorPool(m_Device->GetDevice(), m_DescriptorPool, nullptr);
+	// Free cached sets, their keys name the destroyed buffers
+	m_DescriptorCache->Reset();
 }
 
 // Create Vulkan image views
@@ -322,291 +525,127 @@ void Application::CreateImageViews() {
 	}
 }
 
-// Create Vulkan rendering pass
-void Application::CreateRenderPass(){
-
-	// Vulkan colour attachment description
-	VkAttachmentDescription colorAttachment = {};
-	colorAttachment.format = m_SwapChainImageFormat;
-	colorAttachment.samples = m_Device->GetSamples();
-	colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-	// Colour attachment reference
-	VkAttachmentReference colorAttachmentRef = {};
-	colorAttachmentRef.attachment = 0;
-	colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-	// Vulkan depth attachment description
-	VkAttachmentDescription depthAttachment = {};
-	depthAttachment.format = FindDepthFormat();
-	depthAttachment.samples = m_Device->GetSamples();
-	depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-	// Depth attachment reference
-	VkAttachmentReference depthAttachmentRef = {};
-	depthAttachmentRef.attachment = 1;
-	depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-	// Colour attachment resolve
-	VkAttachmentDescription colourAttachmentResolve = {};
-	colourAttachmentResolve.format = m_SwapChainImageFormat;
-	colourAttachmentResolve.samples = VK_SAMPLE_COUNT_1_BIT;
-	colourAttachmentResolve.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	colourAttachmentResolve.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	colourAttachmentResolve.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	colourAttachmentResolve.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	colourAttachmentResolve.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	colourAttachmentResolve.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
-	// Reference to colour attachment resolver
-	VkAttachmentReference colourAttachmentResolveRef = {};
-	colourAttachmentResolveRef.attachment = 2;
-	colourAttachmentResolveRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-	// Subpass references
-	VkSubpassDescription subpass = {};
-	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-	subpass.colorAttachmentCount = 1;
-	subpass.pColorAttachments = &colorAttachmentRef;
-	subpass.pDepthStencilAttachment = &depthAttachmentRef;
-	subpass.pResolveAttachments = &colourAttachmentResolveRef;
-
-	// Create subpass dependencies
-	VkSubpassDependency dependency = {};
-	dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-	dependency.dstSubpass = 0;
-	dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependency.srcAccessMask = 0;
-	dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-	
-	// Render pass creation info
-	std::array<VkAttachmentDescription, 3> attachments = { colorAttachment, depthAttachment, colourAttachmentResolve };
-	VkRenderPassCreateInfo renderPassInfo = {};
-	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-	renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
-	renderPassInfo.pAttachments = attachments.data();
-	renderPassInfo.subpassCount = 1;
-	renderPassInfo.pSubpasses = &subpass;
-	renderPassInfo.dependencyCount = 1;
-	renderPassInfo.pDependencies = &dependency;
-	
-	// Create render pass
-	if (vkCreateRenderPass(m_Device->GetDevice(), &renderPassInfo, nullptr, &m_RenderPass) != VK_SUCCESS) {
-		throw std::runtime_error("Failed to create render pass!");
+// Load scene shaders, reflected as they are loaded
+void Application::LoadShaders() {
+	m_ShaderLibrary = new ShaderLibrary(m_Device->GetDevice());
+	// Bindless fragment shader indexes one texture table, which must exist before the shader is used
+	std::string fragmentPath = "src/res/shaders/frag.spv";
+	if (m_Device->IsBindlessSupported()) {
+		try {
+			m_BindlessTextures = new BindlessTextures(m_Device);
+			m_Shader = new Shader(m_ShaderLibrary, "src/res/shaders/vert.spv", "src/res/shaders/bindless_frag.spv");
+			fragmentPath = "src/res/shaders/bindless_frag.spv";
+		}
+		catch (const std::runtime_error& e) {
+			std::cout << e.what() << " Using per image texture descriptors" << std::endl;
+			delete(m_BindlessTextures);
+			m_BindlessTextures = nullptr;
+		}
+	}
+	if (m_Shader == nullptr) {
+		m_Shader = new Shader(m_ShaderLibrary, "src/res/shaders/vert.spv", fragmentPath);
+	}
+
+	// Modules built before the feature toggles always draw textured
+	if (m_ShaderLibrary->GetReflection(m_Shader->GetFragmentShaderModule()).GetSpecializationConstants().empty()) {
+		std::cout << fragmentPath << " has no shader feature constants, rebuild it with compile.bat to toggle features" << std::endl;
 	}
 }
 
-// Create descriptor set layout
+// Create descriptor set and pipeline layouts from the scene shaders' reflection
 void Application::CreateDescriptorSetLayout(){
+	m_LayoutCache = new LayoutCache(m_Device->GetDevice());
 
-	// Descriptor binding info
-	VkDescriptorSetLayoutBinding uboLayoutBinding = {};
-	uboLayoutBinding.binding = 0;
-	uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	uboLayoutBinding.descriptorCount = 1;
-	uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-	uboLayoutBinding.pImmutableSamplers = nullptr;
-
-	// Descriptor for sampler
-	VkDescriptorSetLayoutBinding samplerLayoutBinding = {};
-	samplerLayoutBinding.binding = 1;
-	samplerLayoutBinding.descriptorCount = 1;
-	samplerLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	samplerLayoutBinding.pImmutableSamplers = nullptr;
-	samplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-
-	// Descriptor set layout creation info
-	std::array<VkDescriptorSetLayoutBinding, 2> bindings = { uboLayoutBinding, samplerLayoutBinding };
-	VkDescriptorSetLayoutCreateInfo layoutInfo = {};
-	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-	layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
-	layoutInfo.pBindings = bindings.data();
-	
-	// Create descriptor set layout
-	if (vkCreateDescriptorSetLayout(m_Device->GetDevice(), &layoutInfo, nullptr, &m_DescriptorSetLayout) != VK_SUCCESS) {
-		throw std::runtime_error("Failed to create descriptor set layout!");
+	// Bindless texture table is set 1
+	std::map<uint32_t, VkDescriptorSetLayout> externalSets;
+	if (m_BindlessTextures != nullptr) {
+		externalSets[1] = m_BindlessTextures->GetSetLayout();
 	}
 
+	// Bindings come from the shaders, so they cannot drift from the GLSL
+	ShaderLayout layout = m_LayoutCache->GetShaderLayout({
+		&m_ShaderLibrary->GetReflection(m_Shader->GetVertexShaderModule()),
+		&m_ShaderLibrary->GetReflection(m_Shader->GetFragmentShaderModule())
+	}, externalSets);
+	if (layout.setLayouts.size() != externalSets.size() + 1) {
+		throw std::runtime_error("Scene shaders must use descriptor set 0, and set 1 only for bindless textures!");
+	}
+	m_DescriptorSetLayout = layout.setLayouts[0];
+	m_PipelineLayout = layout.pipelineLayout;
 }
 
-// Create Vulkan graphics pipeline
+// Scene pipeline from the library, waits only if its precompile has not finished
 void Application::CreateGraphicsPipeline(){	
-	// Create shader
-	Shader shader(m_Device->GetDevice(), "src/res/shaders/vert.spv", "src/res/shaders/frag.spv");
-
-	// Vertex shader stage creation info
-	VkPipelineShaderStageCreateInfo vertShaderStageInfo = {};
-	vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-	vertShaderStageInfo.module = shader.GetVertexShaderModule();
-	vertShaderStageInfo.pName = "main";
-
-	// Fragment shader stage creation info
-	VkPipelineShaderStageCreateInfo fragShaderStageInfo = {};
-	fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-	fragShaderStageInfo.module = shader.GetFragmentShaderModule();
-	fragShaderStageInfo.pName = "main";
-
-	// Put info into array
-	VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
-
-	// Vertex input creation info
-	VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
-	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-	auto bindingDescription = Vertex::GetBindingDescription();
+	m_GraphicsPipeline = m_PipelineLibrary->GetPipeline(GetScenePipelineState(), PIPELINE_MISS_POLICY_BLOCK);
+	m_ScenePipelineFeatures = m_SceneFeatures;
+}
+
+// Switch to scene pipeline variant of requested features once compiled
+void Application::UpdateScenePipeline() {
+	if (m_SceneFeatures == m_ScenePipelineFeatures) {
+		return;
+	}
+
+	// Current variant keeps drawing while the new one compiles
+	VkPipeline pipeline = m_PipelineLibrary->GetPipeline(GetScenePipelineState(), PIPELINE_MISS_POLICY_SKIP);
+	if (pipeline == VK_NULL_HANDLE) {
+		return;
+	}
+	m_ScenePipelineFeatures = m_SceneFeatures;
+	if (pipeline != m_GraphicsPipeline) {
+		m_GraphicsPipeline = pipeline;
+		std::fill(m_StaticBundleDirty.begin(), m_StaticBundleDirty.end(), true);
+	}
+}
+
+// State of pipeline drawing the model into the scene pass
+PipelineState Application::GetScenePipelineState() {
+	PipelineState state;
+	state.vertexShader = m_Shader->GetVertexShaderModule();
+	state.fragmentShader = m_Shader->GetFragmentShaderModule();
+	state.vertexShaderHash = m_ShaderLibrary->GetHash(state.vertexShader);
+	state.fragmentShaderHash = m_ShaderLibrary->GetHash(state.fragmentShader);
+	state.bindings = { Vertex::GetBindingDescription() };
+	const ShaderReflection& vertexReflection = m_ShaderLibrary->GetReflection(state.vertexShader);
+	const ShaderReflection& fragmentReflection = m_ShaderLibrary->GetReflection(state.fragmentShader);
+
+	// Attributes the vertex shader reads, which must exist in Vertex with the same format
 	auto attributeDescriptions = Vertex::GetAttributeDescriptions();
-	vertexInputInfo.vertexBindingDescriptionCount = 1;
-	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-	vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
-	vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
-
-	// Input assembly creation info
-	VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
-	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-	inputAssembly.primitiveRestartEnable = VK_FALSE;
-
-	// Viewport details
-	VkViewport viewport = {};
-	viewport.x = 0.0f;
-	viewport.y = 0.0f;
-	viewport.width = (float)m_SwapChainExtent.width;
-	viewport.height = (float)m_SwapChainExtent.height;
-	viewport.minDepth = 0.0f;
-	viewport.maxDepth = 1.0f;
+	for (const ReflectedInput& input : vertexReflection.GetInputs()) {
+		auto attribute = std::find_if(attributeDescriptions.begin(), attributeDescriptions.end(), [&input](const VkVertexInputAttributeDescription& description) {
+			return description.location == input.location;
+		});
+		if (attribute == attributeDescriptions.end() || attribute->format != input.format) {
+			throw std::runtime_error("Vertex shader input " + std::to_string(input.location) + " does not match a Vertex attribute!");
+		}
+		state.attributes.push_back(*attribute);
+	}
 
-	// Scissor details
-	VkRect2D scissor = {};
-	scissor.offset = { 0, 0 };
-	scissor.extent = m_SwapChainExtent;
-
-	// Viewport state creation info
-	VkPipelineViewportStateCreateInfo viewportState = {};
-	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-	viewportState.viewportCount = 1;
-	viewportState.pViewports = &viewport;
-	viewportState.scissorCount = 1;
-	viewportState.pScissors = &scissor;
-
-	// Rasterizer creation info
-	VkPipelineRasterizationStateCreateInfo rasterizer = {};
-	rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-	rasterizer.depthClampEnable = VK_FALSE;
-	rasterizer.rasterizerDiscardEnable = VK_FALSE;
-	rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
-	rasterizer.lineWidth = 1.0f;
-	rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-	rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
-	rasterizer.depthBiasEnable = VK_FALSE;
-	rasterizer.depthBiasConstantFactor = 0.0f;
-	rasterizer.depthBiasClamp = 0.0f;
-	rasterizer.depthBiasSlopeFactor = 0.0f;
-
-	// Multisampling info
-	VkPipelineMultisampleStateCreateInfo multisampling = {};
-	multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-	multisampling.sampleShadingEnable = VK_FALSE;
-	multisampling.rasterizationSamples = m_Device->GetSamples();
-	multisampling.minSampleShading = 1.0f;
-	multisampling.pSampleMask = nullptr;
-	multisampling.alphaToCoverageEnable = VK_FALSE;
-	multisampling.alphaToOneEnable = VK_FALSE;
-
-	// Depth stencil info
-	VkPipelineDepthStencilStateCreateInfo depthStencil = {};
-	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-	depthStencil.depthTestEnable = VK_TRUE;
-	depthStencil.depthWriteEnable = VK_TRUE;
-	depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
-	depthStencil.depthBoundsTestEnable = VK_FALSE;
-	depthStencil.minDepthBounds = 0.0f;
-	depthStencil.maxDepthBounds = 1.0f;
-	depthStencil.stencilTestEnable = VK_FALSE;
-	depthStencil.front = {};
-	depthStencil.back = {};
-
-	// Colour blending info
-	VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
-	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-	colorBlendAttachment.blendEnable = VK_FALSE;
-	colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
-	colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
-	colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
-	colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-	colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-	colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
-
-	// Colour blending state info
-	VkPipelineColorBlendStateCreateInfo colorBlending = {};
-	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-	colorBlending.logicOpEnable = VK_FALSE;
-	colorBlending.logicOp = VK_LOGIC_OP_COPY;
-	colorBlending.attachmentCount = 1;
-	colorBlending.pAttachments = &colorBlendAttachment;
-	colorBlending.blendConstants[0] = 0.0f;
-	colorBlending.blendConstants[1] = 0.0f;
-	colorBlending.blendConstants[2] = 0.0f;
-	colorBlending.blendConstants[3] = 0.0f;
-
-	// Dynamic state of pipeline
-	VkDynamicState dynamicStates[] = {
-		VK_DYNAMIC_STATE_VIEWPORT,
-		VK_DYNAMIC_STATE_LINE_WIDTH
-	};
-	VkPipelineDynamicStateCreateInfo dynamicState = {};
-	dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-	dynamicState.dynamicStateCount = 2;
-	dynamicState.pDynamicStates = dynamicStates;
-
-	// Pipeline layout creation info
-	VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
-	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	pipelineLayoutInfo.setLayoutCount = 1;
-	pipelineLayoutInfo.pSetLayouts = &m_DescriptorSetLayout;
-	pipelineLayoutInfo.pushConstantRangeCount = 0;
-	pipelineLayoutInfo.pPushConstantRanges = nullptr;
-
-	// Create pipeline layout
-	if (vkCreatePipelineLayout(m_Device->GetDevice(), &pipelineLayoutInfo, nullptr, &m_PipelineLayout) != VK_SUCCESS) {
-		throw std::runtime_error("Failed to create pipeline layout!");
-	}
-
-	// Graphics pipeline creation info
-	VkGraphicsPipelineCreateInfo pipelineInfo = {};
-	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-	pipelineInfo.stageCount = 2;
-	pipelineInfo.pStages = shaderStages;
-	pipelineInfo.pVertexInputState = &vertexInputInfo;
-	pipelineInfo.pInputAssemblyState = &inputAssembly;
-	pipelineInfo.pViewportState = &viewportState;
-	pipelineInfo.pRasterizationState = &rasterizer;
-	pipelineInfo.pMultisampleState = &multisampling;
-	pipelineInfo.pDepthStencilState = &depthStencil;
-	pipelineInfo.pColorBlendState = &colorBlending;
-	pipelineInfo.pDynamicState = nullptr;
-	pipelineInfo.layout = m_PipelineLayout;
-	pipelineInfo.renderPass = m_RenderPass;
-	pipelineInfo.subpass = 0;
-	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
-	pipelineInfo.basePipelineIndex = -1;
-
-	// Create pipeline
-	if (vkCreateGraphicsPipelines(m_Device->GetDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_GraphicsPipeline) != VK_SUCCESS) {
-		throw std::runtime_error("Failed to create graphics pipeline!");
+	// Feature toggles the shaders declare, others would only duplicate pipelines
+	for (uint32_t feature = 0; feature < SHADER_FEATURE_COUNT; feature++) {
+		if (vertexReflection.HasSpecializationConstant(feature) || fragmentReflection.HasSpecializationConstant(feature)) {
+			state.specialization.push_back({ feature, (m_SceneFeatures >> feature) & 1 });
+		}
 	}
 
+	state.samples = m_Device->GetSamples();
+	state.layout = m_PipelineLayout;
+	state.renderPass = m_RenderGraph->GetRenderPass(m_ScenePass);
+	state.renderPassKey = m_RenderGraph->GetRenderPassKey(m_ScenePass);
+	return state;
+}
+
+// Load pipeline cache from disk
+void Application::CreatePipelineCache() {
+	m_PipelineCache = new PipelineCache(m_Device);
+}
+
+// Start compiling the pipelines used with the scene shaders
+void Application::CreatePipelineLibrary() {
+	m_PipelineLibrary = new PipelineLibrary(m_Device, m_PipelineCache, m_JobSystem);
+
+	// Compiles overlap loading the model and texture
+	m_PipelineLibrary->Precompile({ GetScenePipelineState() });
 }
 
 // Create Vulkan command pool
@@ -614,160 +653,249 @@ void Application::CreateCommandPool(){
 
 	m_CommandPool = new CommandPool(m_Device);
 
+	// Recording workers, each job records with its own pool
+	m_JobSystem = new JobSystem();
+	for (uint32_t i = 0; i < m_JobSystem->GetThreadCount(); i++) {
+		m_ThreadCommandPools.push_back(new CommandPool(m_Device));
+	}
 }
 
-// Create and allocate resources for antialiasing
-void Application::CreateColourResources(){
-	// Get colour format
-	VkFormat colourFormat = m_SwapChainImageFormat;
-
-	// Create colour image
-	m_ColourImage = new Image(m_Device, m_CommandPool, m_SwapChainExtent.width, m_SwapChainExtent.height, 1, m_Device->GetSamples(), colourFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
+// Scale scene resolution to hold configured GPU frame rate
+void Application::CreateDynamicResolution(){
+	if (m_Config.resolutionTargetFrameRate > 0) {
+		m_DynamicResolution = new DynamicResolution(m_Device, m_Config.framesInFlight, m_Config.resolutionTargetFrameRate);
+	}
 }
 
-// Create and allocate resources for depth buffering
-void Application::CreateDepthResources(){
-
-	// Find depth format
-	VkFormat depthFormat = FindDepthFormat();
+// Declare frame passes and create their render passes and attachments
+void Application::CreateRenderGraph(){
+	m_RenderGraph = new RenderGraph(m_Device, m_CommandPool);
+	m_RenderExtent = m_DynamicResolution != nullptr ? m_DynamicResolution->GetRenderExtent(m_SwapChainExtent) : m_SwapChainExtent;
+
+	// Multisampled attachments and the swap chain image they resolve into
+	RenderGraphResource colour = m_RenderGraph->CreateImage("Colour", m_SwapChainExtent, m_SwapChainImageFormat, m_Device->GetSamples(), VK_IMAGE_ASPECT_COLOR_BIT);
+	RenderGraphResource depth = m_RenderGraph->CreateImage("Depth", m_SwapChainExtent, FindDepthFormat(), m_Device->GetSamples(), VK_IMAGE_ASPECT_DEPTH_BIT);
+	ResourceUsage backBufferUsage = m_Config.headless ? RESOURCE_USAGE_TRANSFER_SRC : RESOURCE_USAGE_PRESENT;
+	m_BackBuffer = m_RenderGraph->ImportImage("Back buffer", m_SwapChainExtent, m_SwapChainImageFormat, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_ASPECT_COLOR_BIT, backBufferUsage);
+
+	// With dynamic resolution the scene resolves into a full size image of which only the render extent is used
+	RenderGraphResource sceneTarget = m_BackBuffer;
+	if (m_DynamicResolution != nullptr) {
+		m_SceneColour = m_RenderGraph->CreateImage("Scene", m_SwapChainExtent, m_SwapChainImageFormat, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
+		sceneTarget = m_SceneColour;
+	}
 
-	// Create image
-	m_DepthImage = new Image(m_Device, m_CommandPool, m_SwapChainExtent.width, m_SwapChainExtent.height, 1, m_Device->GetSamples(), depthFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_IMAGE_ASPECT_DEPTH_BIT);
+	// Scene pass replays static bundles of the image being recorded
+	m_ScenePass = m_RenderGraph->AddPass("Scene", [this](VkCommandBuffer commandBuffer) {
+		std::vector<VkCommandBuffer> secondaryCommandBuffers(m_StaticBundleJobCounts[m_ImageIndex]);
+		for (uint32_t job = 0; job < m_StaticBundleJobCounts[m_ImageIndex]; job++) {
+			secondaryCommandBuffers[job] = m_StaticBundles[job][m_ImageIndex];
+		}
 
-	// Transition depth image to attachment
-	m_DepthImage->TransitionImageLayout(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, 1);
+		// Execute static geometry, dynamic draws would be recorded here each frame
+		vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(secondaryCommandBuffers.size()), secondaryCommandBuffers.data());
+	}, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+	m_RenderGraph->Write(m_ScenePass, colour, RESOURCE_USAGE_COLOUR_ATTACHMENT);
+	m_RenderGraph->Write(m_ScenePass, depth, RESOURCE_USAGE_DEPTH_ATTACHMENT);
+	m_RenderGraph->Write(m_ScenePass, sceneTarget, RESOURCE_USAGE_RESOLVE_ATTACHMENT);
+
+	// Upscale rendered area of scene into the whole back buffer
+	if (m_DynamicResolution != nullptr) {
+		m_RenderGraph->SetRenderArea(m_ScenePass, m_RenderExtent);
+
+		uint32_t upscalePass = m_RenderGraph->AddPass("Upscale", [this](VkCommandBuffer commandBuffer) {
+			VkImageBlit blit = {};
+			blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			blit.srcSubresource.layerCount = 1;
+			blit.srcOffsets[1] = { static_cast<int32_t>(m_RenderExtent.width), static_cast<int32_t>(m_RenderExtent.height), 1 };
+			blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			blit.dstSubresource.layerCount = 1;
+			blit.dstOffsets[1] = { static_cast<int32_t>(m_SwapChainExtent.width), static_cast<int32_t>(m_SwapChainExtent.height), 1 };
+
+			vkCmdBlitImage(commandBuffer, m_RenderGraph->GetImage(m_SceneColour), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+				m_RenderGraph->GetImage(m_BackBuffer), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+		});
+		m_RenderGraph->Read(upscalePass, m_SceneColour, RESOURCE_USAGE_TRANSFER_SRC);
+		m_RenderGraph->Write(upscalePass, m_BackBuffer, RESOURCE_USAGE_TRANSFER_DST);
+	}
 
+	m_RenderGraph->Compile();
 }
 
-// Create command buffers for command pool
+// Create per frame command buffers
 void Application::CreateCommandBuffers(){
-	// Resize to fit all framebuffers
-	m_CommandBuffers.resize(m_SwapChainFramebuffers.size());
-
-	// Command buffer allocation info
-	VkCommandBufferAllocateInfo allocInfo = {};
-	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	allocInfo.commandPool = m_CommandPool->GetCommandPool();
-	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	allocInfo.commandBufferCount = (uint32_t)m_CommandBuffers.size();
-
-	// Allocate command buffers
-	if (vkAllocateCommandBuffers(m_Device->GetDevice(), &allocInfo, m_CommandBuffers.data()) != VK_SUCCESS) {
-		throw std::runtime_error("Failed to allocate command buffers!");
-	}
-
-	// Start command buffers
-	for (size_t i = 0; i < m_CommandBuffers.size(); i++) {
-		VkCommandBufferBeginInfo beginInfo = {};
-		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		beginInfo.flags = 0;
-		beginInfo.pInheritanceInfo = nullptr;
-
-		// Begin buffer
-		if (vkBeginCommandBuffer(m_CommandBuffers[i], &beginInfo) != VK_SUCCESS) {
-			throw std::runtime_error("Failed to begin recording command buffer!");
-		}
+	// Transient pool per frame in flight, reset instead of freeing buffers one by one
+	for (size_t i = 0; i < m_Config.framesInFlight; i++) {
+		m_FrameCommandPools.push_back(new CommandPool(m_Device, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT));
+		m_CommandBuffers.push_back(m_FrameCommandPools[i]->AllocateCommandBuffers(1, VK_COMMAND_BUFFER_LEVEL_PRIMARY)[0]);
+	}
+}
 
-		// Render pass begin info
-		std::array<VkClearValue, 2> clearValues = {};
-		clearValues[0].color = { 0.0f, 0.0f, 0.0f, 1.0f };
-		clearValues[1].depthStencil = { 1.0f, 0 };
-		VkRenderPassBeginInfo renderPassInfo = {};
-		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-		renderPassInfo.renderPass = m_RenderPass;
-		renderPassInfo.framebuffer = m_SwapChainFramebuffers[i];
-		renderPassInfo.renderArea.offset = { 0, 0 };
-		renderPassInfo.renderArea.extent = m_SwapChainExtent;
-		renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-		renderPassInfo.pClearValues = clearValues.data();
+// Allocate static bundles for swap chain images, recorded on first use
+void Application::CreateStaticBundles(){
+	uint32_t imageCount = static_cast<uint32_t>(m_SwapChainImages.size());
 
-		// Begin render pass
-		vkCmdBeginRenderPass(m_CommandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+	// Secondary command buffers from each job's pool
+	m_StaticBundles.resize(m_ThreadCommandPools.size());
+	for (size_t job = 0; job < m_ThreadCommandPools.size(); job++) {
+		m_StaticBundles[job] = m_ThreadCommandPools[job]->AllocateCommandBuffers(imageCount, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+	}
+	m_StaticBundleJobCounts.assign(imageCount, 0);
+
+	// No frame has used the swap chain images yet
+	m_ImagesInFlight.assign(imageCount, 0);
+	m_StaticBundleDirty.assign(imageCount, true);
+}
 
-		// Bind graphics pipeline
-		vkCmdBindPipeline(m_CommandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, m_GraphicsPipeline);
+// Record static geometry for swap chain image, 0 jobs uses every worker
+void Application::RecordStaticBundles(size_t i, uint32_t jobCount){
+	// Split draws between jobs, never more jobs than draws
+	if (jobCount == 0 || jobCount > m_ThreadCommandPools.size()) {
+		jobCount = static_cast<uint32_t>(m_ThreadCommandPools.size());
+	}
+	jobCount = std::max(std::min(jobCount, m_DrawCount), 1u);
+	uint32_t drawsPerJob = (m_DrawCount + jobCount - 1) / jobCount;
+
+	// Record secondary command buffers in parallel
+	m_JobSystem->ParallelFor(jobCount, [&](uint32_t job) {
+		uint32_t firstDraw = std::min(job * drawsPerJob, m_DrawCount);
+		uint32_t drawCount = std::min(drawsPerJob, m_DrawCount - firstDraw);
+		RecordDraws(m_StaticBundles[job][i], i, firstDraw, drawCount);
+	});
+	m_StaticBundleJobCounts[i] = jobCount;
+}
 
-		// Bind model
-		m_Model->Bind(m_CommandBuffers[i]);
+// Record this frame's primary command buffer from its transient pool
+void Application::RecordFrameCommands(uint32_t imageIndex){
+	VkCommandBuffer commandBuffer = m_CommandBuffers[m_CurrentFrame];
 
-		// Bind descriptor sets
-		vkCmdBindDescriptorSets(m_CommandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 0, 1, &m_DescriptorSets[i], 0, nullptr);
+	// Frame's previous submission has finished, so its pool can be recycled
+	m_FrameCommandPools[m_CurrentFrame]->Reset();
 
-		// Draw model
-		m_Model->Draw(m_CommandBuffers[i]);
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	beginInfo.pInheritanceInfo = nullptr;
 
-		// End render pass
-		vkCmdEndRenderPass(m_CommandBuffers[i]);
+	// Begin buffer
+	if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to begin recording command buffer!");
+	}
 
-		// End recording
-		if (vkEndCommandBuffer(m_CommandBuffers[i]) != VK_SUCCESS) {
-			throw std::runtime_error("Failed to record command buffer!");
-		}
+	// Time frame for dynamic resolution
+	if (m_DynamicResolution != nullptr) {
+		m_DynamicResolution->BeginFrame(commandBuffer, static_cast<uint32_t>(m_CurrentFrame));
 	}
 
-	
+	// Record passes into the acquired image
+	m_ImageIndex = imageIndex;
+	m_RenderGraph->SetImportedImage(m_BackBuffer, m_SwapChainImages[imageIndex], m_SwapChainImageViews[imageIndex]->GetImageView());
+	m_RenderGraph->Execute(commandBuffer);
+	if (m_DynamicResolution != nullptr) {
+		m_DynamicResolution->EndFrame(commandBuffer, static_cast<uint32_t>(m_CurrentFrame));
+	}
+
+	// End recording
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to record command buffer!");
+	}
 }
 
-// Create frame buffers
-void Application::CreateFramebuffers(){
-	// Resize container to hold all framebuffers
-	m_SwapChainFramebuffers.resize(m_SwapChainImageViews.size());
-
-	// Loop through image views
-	for (size_t i = 0; i < m_SwapChainImageViews.size(); i++) {
-		// Create attachments
-		std::array<VkImageView, 3> attachments = { m_ColourImage->GetImageView(), m_DepthImage->GetImageView(), m_SwapChainImageViews[i]->GetImageView() };
-
-		// Framebuffer creation info
-		VkFramebufferCreateInfo framebufferInfo = {};
-		framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-		framebufferInfo.renderPass = m_RenderPass;
-		framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
-		framebufferInfo.pAttachments = attachments.data();
-		framebufferInfo.width = m_SwapChainExtent.width;
-		framebufferInfo.height = m_SwapChainExtent.height;
-		framebufferInfo.layers = 1;
-
-		// Create framebuffer for each image view
-		if (vkCreateFramebuffer(m_Device->GetDevice(), &framebufferInfo, nullptr, &m_SwapChainFramebuffers[i]) != VK_SUCCESS) {
-			throw std::runtime_error("Failed to create framebuffer!");
+// Record range of draws into secondary command buffer
+void Application::RecordDraws(VkCommandBuffer commandBuffer, size_t i, uint32_t firstDraw, uint32_t drawCount){
+	// Secondary command buffer continues the render pass
+	VkCommandBufferInheritanceInfo inheritanceInfo = {};
+	inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritanceInfo.renderPass = m_RenderGraph->GetRenderPass(m_ScenePass);
+	inheritanceInfo.subpass = 0;
+	inheritanceInfo.framebuffer = VK_NULL_HANDLE;
+
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+	beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+	// Begin buffer
+	if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to begin recording secondary command buffer!");
+	}
+
+	// Bind graphics pipeline
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_GraphicsPipeline);
+
+	// Dynamic state, secondary command buffers do not inherit it from the frame
+	VkViewport viewport = {};
+	viewport.x = 0.0f;
+	viewport.y = 0.0f;
+	viewport.width = (float)m_RenderExtent.width;
+	viewport.height = (float)m_RenderExtent.height;
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+	VkRect2D scissor = {};
+	scissor.offset = { 0, 0 };
+	scissor.extent = m_RenderExtent;
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+	vkCmdSetLineWidth(commandBuffer, 1.0f);
+
+	// Bind model
+	m_Model->Bind(commandBuffer);
+
+	// Bind descriptor sets, the bindless table once for every draw
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 0, 1, &m_DescriptorSets[i], 0, nullptr);
+	if (m_BindlessTextures != nullptr) {
+		VkDescriptorSet textureSet = m_BindlessTextures->GetDescriptorSet();
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 1, 1, &textureSet, 0, nullptr);
+	}
+
+	// Draw model, texture index travels with each draw
+	for (uint32_t draw = firstDraw; draw < firstDraw + drawCount; draw++) {
+		if (m_BindlessTextures != nullptr) {
+			vkCmdPushConstants(commandBuffer, m_PipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(uint32_t), &m_ModelTextureIndex);
 		}
+		m_Model->Draw(commandBuffer);
+	}
+
+	// End recording
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to record secondary command buffer!");
 	}
 }
 
 // Create semaphores
 void Application::CreateSemaphores(){
 	// Resize semaphores vector to fit a semaphore for every concurrent frame
-	m_ImageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-	m_RenderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-	m_InFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
+	m_ImageAvailableSemaphores.resize(m_Config.framesInFlight);
+	m_RenderFinishedSemaphores.resize(m_Config.framesInFlight);
+	m_FrameTimelineValues.assign(m_Config.framesInFlight, 0);
 
 	// Semaphore creation info
 	VkSemaphoreCreateInfo semaphoreInfo = {};
 	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-	// Fence creation info
-	VkFenceCreateInfo fenceInfo = {};
-	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-	fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
 	// Create semaphores for each frame
-	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+	for (size_t i = 0; i < m_Config.framesInFlight; i++) {
 		if (vkCreateSemaphore(m_Device->GetDevice(), &semaphoreInfo, nullptr, &m_ImageAvailableSemaphores[i]) != VK_SUCCESS) {
 			throw std::runtime_error("Failed to create image available semaphore for a frame!");
 		}
 		if (vkCreateSemaphore(m_Device->GetDevice(), &semaphoreInfo, nullptr, &m_RenderFinishedSemaphores[i]) != VK_SUCCESS) {
 			throw std::runtime_error("Failed to create render finished semaphore for a frame!");
 		}
-		if (vkCreateFence(m_Device->GetDevice(), &fenceInfo, nullptr, &m_InFlightFences[i]) != VK_SUCCESS) {
-			throw std::runtime_error("Failed to create fence for a frame!");
-		}
 	}
 
 	// Initialise currentframe
 	m_CurrentFrame = 0;
 }
 
+// Give model texture a slot in the bindless table
+void Application::RegisterTextures() {
+	if (m_BindlessTextures != nullptr) {
+		m_ModelTextureIndex = m_BindlessTextures->Add(m_Model->GetTextureView(), m_TextureSampler);
+	}
+}
+
 // Create texture sampler
 void Application::CreateTextureSampler(){
 
@@ -802,6 +930,16 @@ void Application::LoadModel(){
 	m_Model = new Model(m_Device, m_CommandPool, "src/res/models/kurpitsa_.obj", "src/res/textures/kurpitsa_.png");
 }
 
+// Create defragmenter and register movable resources
+void Application::CreateDefragmenter(){
+	m_Defragmenter = new Defragmenter(m_Device, m_CommandPool);
+
+	// Register model resources
+	m_Defragmenter->Register(m_Model->GetVertexBuffer());
+	m_Defragmenter->Register(m_Model->GetIndexBuffer());
+	m_Defragmenter->Register(m_Model->GetTexture()->GetImage());
+}
+
 // Create uniform buffers
 void Application::CreateUniformBuffers(){
 
@@ -816,95 +954,106 @@ void Application::CreateUniformBuffers(){
 
 }
 
-// Create descriptor pool
-void Application::CreateDescriptorPool(){
-
-	// Pool size description
-	std::array<VkDescriptorPoolSize, 2> poolSizes = {};
-	poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	poolSizes[0].descriptorCount = static_cast<uint32_t>(m_SwapChainImages.size());
-	poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	poolSizes[1].descriptorCount = static_cast<uint32_t>(m_SwapChainImages.size());
-
-	// Descriptor pool creation info
-	VkDescriptorPoolCreateInfo poolInfo = {};
-	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
-	poolInfo.pPoolSizes = poolSizes.data();
-	poolInfo.maxSets = static_cast<uint32_t>(m_SwapChainImages.size());
-
-	// Create descriptor pool
-	if (vkCreateDescriptorPool(m_Device->GetDevice(), &poolInfo, nullptr, &m_DescriptorPool) != VK_SUCCESS) {
-		throw std::runtime_error("Failed to create descriptor pool!");
-	}
-
+// Create descriptor cache
+void Application::CreateDescriptorCache(){
+	m_DescriptorCache = new DescriptorCache(m_Device);
 }
 
 // Create descriptor sets
 void Application::CreateDescriptorSets(){
-
-	// Create set allocations
-	std::vector<VkDescriptorSetLayout> layouts(m_SwapChainImages.size(), m_DescriptorSetLayout);
-	VkDescriptorSetAllocateInfo allocInfo = {};
-	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	allocInfo.descriptorPool = m_DescriptorPool;
-	allocInfo.descriptorSetCount = static_cast<uint32_t>(m_SwapChainImages.size());
-	allocInfo.pSetLayouts = layouts.data();
-
-	// Resize set and allocate
+	// Populate descriptor sets
 	m_DescriptorSets.resize(m_SwapChainImages.size());
-	if (vkAllocateDescriptorSets(m_Device->GetDevice(), &allocInfo, m_DescriptorSets.data()) != VK_SUCCESS) {
-		throw std::runtime_error("Failed to allocate descriptor sets!");
-	}
-
-	// Populate descriptor set
 	for (size_t i = 0; i < m_SwapChainImages.size(); i++) {
+		UpdateDescriptorSet(i);
+	}
+}
 
-		// Buffer info
-		VkDescriptorBufferInfo bufferInfo = {};
-		bufferInfo.buffer = m_UniformBuffers[i]->GetBuffer();
-		bufferInfo.offset = 0;
-		bufferInfo.range = sizeof(UniformBufferObject);
-
-		// Descriptor image info
-		VkDescriptorImageInfo imageInfo = {};
-		imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		imageInfo.imageView = m_Model->GetTextureView();
-		imageInfo.sampler = m_TextureSampler;
-
-		// Descriptor set update info
-		std::array<VkWriteDescriptorSet, 2> descriptorWrites = {};
-		descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		descriptorWrites[0].dstSet = m_DescriptorSets[i];
-		descriptorWrites[0].dstBinding = 0;
-		descriptorWrites[0].dstArrayElement = 0;
-		descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		descriptorWrites[0].descriptorCount = 1;
-		descriptorWrites[0].pBufferInfo = &bufferInfo;
-
-		descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		descriptorWrites[1].dstSet = m_DescriptorSets[i];
-		descriptorWrites[1].dstBinding = 1;
-		descriptorWrites[1].dstArrayElement = 0;
-		descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		descriptorWrites[1].descriptorCount = 1;
-		descriptorWrites[1].pImageInfo = &imageInfo;
-
-		// update descriptor sets
-		vkUpdateDescriptorSets(m_Device->GetDevice(), static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
-
+// Look up descriptors for swap chain image, written only if no set holds them yet
+void Application::UpdateDescriptorSet(size_t i){
+	// Uniform buffer
+	std::vector<DescriptorWrite> writes(1);
+	writes[0].binding = 0;
+	writes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	writes[0].bufferInfo.buffer = m_UniformBuffers[i]->GetBuffer();
+	writes[0].bufferInfo.offset = 0;
+	writes[0].bufferInfo.range = sizeof(UniformBufferObject);
+
+	// Texture, the bindless table holds it instead
+	if (m_BindlessTextures == nullptr) {
+		DescriptorWrite textureWrite = {};
+		textureWrite.binding = 1;
+		textureWrite.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		textureWrite.imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		textureWrite.imageInfo.imageView = m_Model->GetTextureView();
+		textureWrite.imageInfo.sampler = m_TextureSampler;
+		writes.push_back(textureWrite);
 	}
 
+	m_DescriptorSets[i] = m_DescriptorCache->GetDescriptorSet(m_DescriptorSetLayout, writes);
 }
 
 // Draw frame with Vulkan
 void Application::DrawFrame(){
 	// Wait for frame to be finished
-	vkWaitForFences(m_Device->GetDevice(), 1, &m_InFlightFences[m_CurrentFrame], VK_TRUE, UINT64_MAX);
+	QueueTimeline* timeline = m_Device->GetGraphicsTimeline();
+	timeline->Wait(m_FrameTimelineValues[m_CurrentFrame]);
+
+	// Destroy resources no submitted work references anymore
+	timeline->CollectGarbage();
+	CollectRenderGraphs(false);
+
+	// Adjust scene resolution from the GPU time of the frame that just finished
+	if (m_DynamicResolution != nullptr && m_DynamicResolution->Update(static_cast<uint32_t>(m_CurrentFrame))) {
+		m_RenderExtent = m_DynamicResolution->GetRenderExtent(m_SwapChainExtent);
+		m_RenderGraph->SetRenderArea(m_ScenePass, m_RenderExtent);
+		std::fill(m_StaticBundleDirty.begin(), m_StaticBundleDirty.end(), true);
+	}
 
-	// Aquire next image
+	// Frame starts once the CPU may run ahead again
+	auto frameStart = std::chrono::high_resolution_clock::now();
+	UpdateLatency();
+
+	// Move resources out of sparse memory, commands using the old ones need re-recording
+	std::vector<Buffer*> movedBuffers;
+	std::vector<Image*> movedImages;
+	if (m_Defragmenter->Update(movedBuffers, movedImages)) {
+		std::fill(m_StaticBundleDirty.begin(), m_StaticBundleDirty.end(), true);
+	}
+
+	// Only a moved texture changes descriptors, buffer moves are picked up by re-recording
+	if (std::find(movedImages.begin(), movedImages.end(), m_Model->GetTexture()->GetImage()) != movedImages.end()) {
+		// Moved texture gets a new slot, frames in flight still read the old one
+		if (m_BindlessTextures != nullptr) {
+			uint32_t oldTextureIndex = m_ModelTextureIndex;
+			BindlessTextures* bindlessTextures = m_BindlessTextures;
+			m_ModelTextureIndex = m_BindlessTextures->Add(m_Model->GetTextureView(), m_TextureSampler);
+			timeline->DestroyAfter(timeline->GetLastSubmittedValue(), [bindlessTextures, oldTextureIndex]() {
+				bindlessTextures->Remove(oldTextureIndex);
+			});
+		}
+		// Sets name the old texture view, whose handle may be reused once it is destroyed
+		else {
+			DescriptorCache* oldDescriptorCache = m_DescriptorCache;
+			m_DescriptorCache = new DescriptorCache(m_Device);
+			timeline->DestroyAfter(timeline->GetLastSubmittedValue(), [oldDescriptorCache]() {
+				delete(oldDescriptorCache);
+			});
+		}
+	}
+
+	// Pick up a shader feature variant that finished compiling
+	UpdateScenePipeline();
+
+	// Aquire next image, headless frames use offscreen images round robin
 	uint32_t imageIndex;
-	VkResult result = vkAcquireNextImageKHR(m_Device->GetDevice(), m_SwapChain, UINT64_MAX, m_ImageAvailableSemaphores[m_CurrentFrame], VK_NULL_HANDLE, &imageIndex);
+	VkResult result = VK_SUCCESS;
+	if (m_Config.headless) {
+		imageIndex = m_NextOffscreenImage;
+		m_NextOffscreenImage = (m_NextOffscreenImage + 1) % static_cast<uint32_t>(m_OffscreenImages.size());
+	}
+	else {
+		result = vkAcquireNextImageKHR(m_Device->GetDevice(), m_SwapChain, UINT64_MAX, m_ImageAvailableSemaphores[m_CurrentFrame], VK_NULL_HANDLE, &imageIndex);
+	}
 
 	// Check if swapchain no longer compatible
 	if (result == VK_ERROR_OUT_OF_DATE_KHR) {
@@ -915,6 +1064,19 @@ void Application::DrawFrame(){
 		throw std::runtime_error("Failed to acquire swap chain image");
 	}
 
+	// Wait for previous frame using this image to finish
+	timeline->Wait(m_ImagesInFlight[imageIndex]);
+
+	// Re-record static geometry only when its inputs changed
+	if (m_StaticBundleDirty[imageIndex]) {
+		UpdateDescriptorSet(imageIndex);
+		RecordStaticBundles(imageIndex);
+		m_StaticBundleDirty[imageIndex] = false;
+	}
+
+	// Record this frame's commands
+	RecordFrameCommands(imageIndex);
+
 	// Update uniform buffer
 	UpdateUniformBuffer(imageIndex);
 
@@ -923,19 +1085,24 @@ void Application::DrawFrame(){
 	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 	VkSemaphore waitSemaphores[] = { m_ImageAvailableSemaphores[m_CurrentFrame] };
 	VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-	submitInfo.waitSemaphoreCount = 1;
+	submitInfo.waitSemaphoreCount = m_Config.headless ? 0 : 1;
 	submitInfo.pWaitSemaphores = waitSemaphores;
 	submitInfo.pWaitDstStageMask = waitStages;
 	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &m_CommandBuffers[imageIndex];
+	submitInfo.pCommandBuffers = &m_CommandBuffers[m_CurrentFrame];
 	VkSemaphore signalSemaphores[] = { m_RenderFinishedSemaphores[m_CurrentFrame] };
-	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.signalSemaphoreCount = m_Config.headless ? 0 : 1;
 	submitInfo.pSignalSemaphores = signalSemaphores;
 
-	// Reset fence and submit to queue
-	vkResetFences(m_Device->GetDevice(), 1, &m_InFlightFences[m_CurrentFrame]);
-	if (vkQueueSubmit(m_Device->GetGraphicsQueue(), 1, &submitInfo, m_InFlightFences[m_CurrentFrame]) != VK_SUCCESS) {
-		throw std::runtime_error("Failed to submit draw command buffer!");
+	// Submit to queue, frame and image are done once the timeline passes its value
+	m_FrameTimelineValues[m_CurrentFrame] = timeline->Submit(submitInfo);
+	m_ImagesInFlight[imageIndex] = m_FrameTimelineValues[m_CurrentFrame];
+	m_PendingLatencies.push_back({ m_FrameTimelineValues[m_CurrentFrame], frameStart });
+
+	// Nothing to present when headless
+	if (m_Config.headless) {
+		m_CurrentFrame = (m_CurrentFrame + 1) % m_Config.framesInFlight;
+		return;
 	}
 
 	// Presentation info
@@ -953,8 +1120,12 @@ void Application::DrawFrame(){
 	result = vkQueuePresentKHR(m_Device->GetPresentQueue(), &presentInfo);
 
 	// Check again for swap chain
-	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || m_FramebufferResized) {
+	if (result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR) {
+		m_PresentModeFrames++;
+	}
+	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || m_FramebufferResized || m_PresentModeChanged) {
 		m_FramebufferResized = false;
+		m_PresentModeChanged = false;
 		RecreateSwapChain();
 	}
 	else if (result != VK_SUCCESS) {
@@ -962,7 +1133,7 @@ void Application::DrawFrame(){
 	}
 
 	// Advance to next frame
-	m_CurrentFrame = (m_CurrentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+	m_CurrentFrame = (m_CurrentFrame + 1) % m_Config.framesInFlight;
 }
 
 // Update uniform buffer for rotation
@@ -981,11 +1152,55 @@ void Application::UpdateUniformBuffer(uint32_t currentImage){
 	ubo.proj = glm::perspective(glm::radians(45.0f), m_SwapChainExtent.width / (float)m_SwapChainExtent.height, 0.1f, 10.0f);
 	ubo.proj[1][1] *= -1;
 
-	// Copy data to uniform buffer
-	void* data;
-	vkMapMemory(m_Device->GetDevice(), m_UniformBuffers[currentImage]->GetBufferMemory(), 0, sizeof(ubo), 0, &data);
-	memcpy(data, &ubo, sizeof(ubo));
-	vkUnmapMemory(m_Device->GetDevice(), m_UniformBuffers[currentImage]->GetBufferMemory());
+	// Copy data to persistently mapped uniform buffer
+	memcpy(m_UniformBuffers[currentImage]->GetMappedData(), &ubo, sizeof(ubo));
+}
+
+// Measure frames the GPU has finished since last call
+void Application::UpdateLatency(){
+	QueueTimeline* timeline = m_Device->GetGraphicsTimeline();
+	auto currentTime = std::chrono::high_resolution_clock::now();
+
+	// Finished frames only wait on presentation, polling once per frame overstates completion by at most one frame
+	while (!m_PendingLatencies.empty() && timeline->IsComplete(m_PendingLatencies.front().timelineValue)) {
+		double latency = std::chrono::duration<double>(currentTime - m_PendingLatencies.front().start).count();
+		m_LatencySum += latency;
+		m_LatencyMax = std::max(m_LatencyMax, latency);
+		m_LatencyCount++;
+		m_PresentModeLatencySum += latency;
+		m_PresentModeLatencyCount++;
+		m_PendingLatencies.pop_front();
+	}
+}
+
+// Print latency since last log and reset it
+void Application::LogLatency(){
+	if (m_LatencyCount == 0) {
+		return;
+	}
+
+	std::cout << std::fixed << std::setprecision(2) << "Latency: avg " << m_LatencySum / m_LatencyCount * 1000.0 << " ms, max " << m_LatencyMax * 1000.0 << " ms over "
+		<< m_LatencyCount << " frames (" << (m_Config.headless ? "headless" : GetPresentModeName(m_PresentMode)) << ", " << m_Config.framesInFlight << " frames in flight, " << m_SwapChainImages.size() << " swap chain images)" << std::defaultfloat << std::endl;
+
+	m_LatencySum = 0.0;
+	m_LatencyMax = 0.0;
+	m_LatencyCount = 0;
+}
+
+// Print frame rate and latency achieved in current present mode and reset them
+void Application::LogPresentModeStats(){
+	double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - m_PresentModeStart).count();
+	if (m_PresentModeFrames == 0 || seconds <= 0.0) {
+		return;
+	}
+
+	std::cout << std::fixed << std::setprecision(2) << "Present mode " << GetPresentModeName(m_PresentMode) << ": " << m_PresentModeFrames / seconds << " fps, latency avg "
+		<< (m_PresentModeLatencyCount > 0 ? m_PresentModeLatencySum / m_PresentModeLatencyCount * 1000.0 : 0.0) << " ms over " << m_PresentModeFrames << " frames" << std::defaultfloat << std::endl;
+
+	m_PresentModeStart = std::chrono::high_resolution_clock::now();
+	m_PresentModeFrames = 0;
+	m_PresentModeLatencySum = 0.0;
+	m_PresentModeLatencyCount = 0;
 }
 
 // Setup debug logger
@@ -1026,15 +1241,27 @@ VkSurfaceFormatKHR Application::ChooseSwapSurfaceFormat(const std::vector<VkSurf
 
 // Select appropriate presentation mode
 VkPresentModeKHR Application::ChooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes){
-	
-	// Look for preferable presentation mode
+	// Mode requested by policy
+	VkPresentModeKHR requestedMode = VK_PRESENT_MODE_FIFO_KHR;
+	switch (m_PresentModePolicy) {
+	case PRESENT_MODE_POLICY_FIFO_RELAXED: requestedMode = VK_PRESENT_MODE_FIFO_RELAXED_KHR; break;
+	case PRESENT_MODE_POLICY_MAILBOX: requestedMode = VK_PRESENT_MODE_MAILBOX_KHR; break;
+	case PRESENT_MODE_POLICY_IMMEDIATE: requestedMode = VK_PRESENT_MODE_IMMEDIATE_KHR; break;
+	case PRESENT_MODE_POLICY_AUTO: requestedMode = VK_PRESENT_MODE_MAILBOX_KHR; break;
+	default: break;
+	}
+
+	// Look for requested presentation mode
 	for (const auto& availablePresentMode : availablePresentModes) {
-		if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
+		if (availablePresentMode == requestedMode) {
 			return availablePresentMode;
 		}
 	}
 
 	// Else return guaranteed mode
+	if (m_PresentModePolicy != PRESENT_MODE_POLICY_AUTO) {
+		std::cout << "Present mode " << GetPresentModeName(requestedMode) << " unsupported, using " << GetPresentModeName(VK_PRESENT_MODE_FIFO_KHR) << std::endl;
+	}
 	return VK_PRESENT_MODE_FIFO_KHR;
 }
 
@@ -1065,46 +1292,34 @@ void Application::FramebufferResizeCallback(GLFWwindow* window, int width, int h
 	app->m_FramebufferResized = true;
 }
 
-VkCommandBuffer Application::BeginSingleTimeCommands(){
-	// Command buffer allocation info
-	VkCommandBufferAllocateInfo allocInfo = {};
-	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	allocInfo.commandPool = m_CommandPool->GetCommandPool();
-	allocInfo.commandBufferCount = 1;
-
-	// Allocate command buffer
-	VkCommandBuffer commandBuffer;
-	vkAllocateCommandBuffers(m_Device->GetDevice(), &allocInfo, &commandBuffer);
-
-	// Begin info
-	VkCommandBufferBeginInfo beginInfo = {};
-	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-
-	// Begin command buffer
-	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+// P cycles present mode policy
+void Application::KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods){
+	if (action != GLFW_PRESS) {
+		return;
+	}
 
-	// Return command buffer
-	return commandBuffer;
+	auto app = reinterpret_cast<Application*>(glfwGetWindowUserPointer(window));
+	switch (key) {
+	case GLFW_KEY_P:
+		// Swap chain is rebuilt after the next present
+		app->m_PresentModePolicy = static_cast<PresentModePolicy>((app->m_PresentModePolicy + 1) % PRESENT_MODE_POLICY_COUNT);
+		app->m_PresentModeChanged = true;
+		break;
+	case GLFW_KEY_T: app->m_SceneFeatures ^= 1 << SHADER_FEATURE_TEXTURE; break;
+	case GLFW_KEY_C: app->m_SceneFeatures ^= 1 << SHADER_FEATURE_VERTEX_COLOUR; break;
+	case GLFW_KEY_A: app->m_SceneFeatures ^= 1 << SHADER_FEATURE_ALPHA_TEST; break;
+	}
 }
 
-void Application::EndSingleTimeCommands(VkCommandBuffer commandBuffer){
-	// End command buffer
-	vkEndCommandBuffer(commandBuffer);
-
-	// Command buffer submit info
-	VkSubmitInfo submitInfo = {};
-	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &commandBuffer;
-
-	// Submit to queue
-	vkQueueSubmit(m_Device->GetGraphicsQueue(), 1, &submitInfo, VK_NULL_HANDLE);
-	vkQueueWaitIdle(m_Device->GetGraphicsQueue());
-
-	// Free command buffer
-	vkFreeCommandBuffers(m_Device->GetDevice(), m_CommandPool->GetCommandPool(), 1, &commandBuffer);
+// Name of Vulkan present mode
+const char* Application::GetPresentModeName(VkPresentModeKHR presentMode){
+	switch (presentMode) {
+	case VK_PRESENT_MODE_IMMEDIATE_KHR: return "IMMEDIATE";
+	case VK_PRESENT_MODE_MAILBOX_KHR: return "MAILBOX";
+	case VK_PRESENT_MODE_FIFO_KHR: return "FIFO";
+	case VK_PRESENT_MODE_FIFO_RELAXED_KHR: return "FIFO_RELAXED";
+	default: return "UNKNOWN";
+	}
 }
 
 // Find supported image formats
@@ -1195,12 +1410,14 @@ bool Application::CheckValidationLayerSupport() {
 
 // Get list of enabled extensions
 std::vector<const char*> Application::GetRequiredExtensions(){
-	// Glfw extensions count and list
+	// Glfw extensions count and list, headless needs no surface extensions
 	uint32_t glfwExtensionCount = 0;
-	const char** glfwExtensions;
+	const char** glfwExtensions = nullptr;
 
 	// Get glfw extension count and extensions
-	glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+	if (!m_Config.headless) {
+		glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+	}
 
 	// Make vector from extensions
 	std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
@@ -1210,6 +1427,13 @@ std::vector<const char*> Application::GetRequiredExtensions(){
 		extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
 	}
 
+	// Add optional extensions the instance supports
+	for (const char* extension : optionalInstanceExtensions) {
+		if (Device::CheckInstanceExtensionSupport(extension)) {
+			extensions.push_back(extension);
+		}
+	}
+
 	// Return vector of extensions
 	return extensions;
 }
@@ -5,88 +5,171 @@
 
 #include <vector>
 #include <optional>
+#include <chrono>
+#include <deque>
 
+#include "Benchmark.h"
+#include "BindlessTextures.h"
 #include "Buffer.h"
 #include "CommandPool.h"
+#include "Config.h"
+#include "DescriptorCache.h"
+#include "Defragmenter.h"
 #include "Device.h"
+#include "DynamicResolution.h"
+#include "FramePacer.h"
 #include "Image.h"
+#include "JobSystem.h"
+#include "LayoutCache.h"
 #include "ImageView.h"
 #include "Model.h"
+#include "PipelineCache.h"
+#include "PipelineLibrary.h"
+#include "RenderGraph.h"
 #include "Shader.h"
 #include "Texture.h"
 
 // CONST VARIABLES
 const int WIDTH = 800;
 const int HEIGHT = 600;
-const int MAX_FRAMES_IN_FLIGHT = 2;
+const double MEMORY_LOG_INTERVAL = 5.0;	// Seconds between memory usage and latency log lines
 
 // Application Class
 class Application {
 public:
-	Application();				// Constructor
+	Application(const ApplicationConfig& config);	// Constructor
 	~Application();				// Destructor
 
 	void Run();					// Run application
+	void RunBenchmarks();		// Run micro benchmarks instead of rendering
 private:
+	// STRUCTS
+	struct FrameLatency {
+		uint64_t timelineValue;		// Graphics timeline value of frame's submission
+		std::chrono::high_resolution_clock::time_point start;	// When CPU began the frame
+	};
+
+	struct RetiredRenderGraph {
+		RenderGraph* renderGraph;	// Graph replaced by swap chain recreation
+		uint64_t timelineValue;		// Graphics timeline value of last frame using it
+		std::vector<JobHandle> compiles;	// Pipeline compiles that may use its render passes
+	};
+
 	// VARIABLES
+	ApplicationConfig m_Config;	// Runtime settings
 	GLFWwindow* m_Window;		// Main window
+	FramePacer* m_FramePacer;	// Delays frame starts to the target frame rate
 	VkInstance m_Instance;		// Vulkan instance
 	VkSurfaceKHR m_Surface;		// Vulkan surface
 	Device* m_Device;			// Device object
 	VkSwapchainKHR m_SwapChain;	// Vulkan swap chain
-	VkRenderPass m_RenderPass;	// Vulkan render pass
-	VkPipeline m_GraphicsPipeline;				// Vulkan graphics pipeline
-	VkDescriptorSetLayout m_DescriptorSetLayout;// Vulkan descriptor set layout
-	VkPipelineLayout m_PipelineLayout;			// Vulkan graphics pipeline layout
+	RenderGraph* m_RenderGraph;	// Passes of a frame, owns render passes and attachments
+	std::vector<RetiredRenderGraph> m_RetiredRenderGraphs;	// Old render graphs waiting for frames and compiles
+	uint32_t m_ScenePass;		// Render graph pass drawing the model
+	RenderGraphResource m_BackBuffer;	// Swap chain image imported into render graph
+	RenderGraphResource m_SceneColour;	// Resolved scene upscaled into back buffer, only with dynamic resolution
+	DynamicResolution* m_DynamicResolution = nullptr;	// Chooses scene resolution, null renders at swap chain extent
+	VkExtent2D m_RenderExtent;			// Extent scene is rendered at
+	PipelineCache* m_PipelineCache;				// Pipeline cache kept on disk between runs
+	PipelineLibrary* m_PipelineLibrary;			// Graphics pipelines by state, compiled on workers
+	ShaderLibrary* m_ShaderLibrary;				// Shader modules shared by content
+	Shader* m_Shader = nullptr;					// Scene shader modules, alive while pipelines may compile
+	VkPipeline m_GraphicsPipeline;				// Scene pipeline, owned by pipeline library
+	uint32_t m_SceneFeatures = 1 << SHADER_FEATURE_TEXTURE;	// Requested ShaderFeature bits of scene pipeline
+	uint32_t m_ScenePipelineFeatures = 0;		// ShaderFeature bits of current scene pipeline
+	LayoutCache* m_LayoutCache;					// Descriptor set and pipeline layouts by description
+	VkDescriptorSetLayout m_DescriptorSetLayout;// Scene descriptor set layout, owned by layout cache
+	VkPipelineLayout m_PipelineLayout;			// Scene pipeline layout, owned by layout cache
 	CommandPool* m_CommandPool;					// Vulkan command pool
-	VkDescriptorPool m_DescriptorPool;			// Vulkan descriptor pool
-	std::vector<VkDescriptorSet> m_DescriptorSets;	// Vulkan descriptor sets
+	JobSystem* m_JobSystem;						// Worker threads for parallel recording
+	std::vector<CommandPool*> m_ThreadCommandPools;	// Command pool per recording job, pools must not be shared between threads
+	DescriptorCache* m_DescriptorCache;			// Descriptor sets by contents, pools grow as needed
+	std::vector<VkDescriptorSet> m_DescriptorSets;	// Scene descriptor set per swap chain image, owned by descriptor cache
 	VkSampler m_TextureSampler;					// Vulkan texture sampler
+	BindlessTextures* m_BindlessTextures = nullptr;	// Texture table indexed per draw, null uses the texture in each image's set
+	uint32_t m_ModelTextureIndex = 0;			// Slot of model texture in bindless table
 	Model* m_Model;								// Model to render
+	Defragmenter* m_Defragmenter;				// Moves resources out of sparse memory blocks
 	std::vector<Buffer*> m_UniformBuffers;		// Vector of uniform buffers
-	std::vector<VkCommandBuffer> m_CommandBuffers;		// Vk command buffers
-	std::vector<VkFramebuffer> m_SwapChainFramebuffers;	// Vk framebuffers
+	std::vector<CommandPool*> m_FrameCommandPools;		// Transient command pool per frame in flight, reset when the frame is reused
+	std::vector<VkCommandBuffer> m_CommandBuffers;		// Primary command buffer per frame in flight, recorded every frame
+	std::vector<std::vector<VkCommandBuffer>> m_StaticBundles;	// Secondary command buffers of static geometry per recording job, then per swap chain image
+	std::vector<uint32_t> m_StaticBundleJobCounts;	// Recorded bundles per swap chain image
+	uint32_t m_DrawCount = 1;					// Draws of the model recorded per frame
 	std::vector<VkImage> m_SwapChainImages;		// VkImages in swap chain
 	std::vector<ImageView*> m_SwapChainImageViews;	// Vulkan image views
-	Image* m_ColourImage;						// Image for multisampling
-	Image* m_DepthImage;						// Vulkan depth image
+	std::vector<Image*> m_OffscreenImages;		// Images rendered to instead of swap chain images when headless
+	uint32_t m_NextOffscreenImage = 0;			// Offscreen image used by next headless frame
 	VkFormat m_SwapChainImageFormat;			// Vulkan swap chain image format
 	VkExtent2D m_SwapChainExtent;				// Vulkan swap chain extent
 	VkDebugUtilsMessengerEXT m_DebugMessenger;	// Vulkan debug logger
 	size_t m_CurrentFrame;						// Frame index
+	uint32_t m_ImageIndex;						// Swap chain image being recorded
 	bool m_FramebufferResized = false;			// Bool for if screen has been resized
+	PresentModePolicy m_PresentModePolicy;		// Requested present mode
+	VkPresentModeKHR m_PresentMode = VK_PRESENT_MODE_MAX_ENUM_KHR;	// Present mode of swap chain
+	bool m_PresentModeChanged = false;			// True if swap chain must be rebuilt for a new policy
 
 	// SEMAPHORES AND FRAMES
 	std::vector<VkSemaphore> m_ImageAvailableSemaphores;
 	std::vector<VkSemaphore> m_RenderFinishedSemaphores;
-	std::vector<VkFence> m_InFlightFences;
+	std::vector<uint64_t> m_FrameTimelineValues;	// Graphics timeline value of each frame in flight's last submission
+	std::vector<uint64_t> m_ImagesInFlight;		// Graphics timeline value of frame last using each swap chain image
+	std::vector<bool> m_StaticBundleDirty;		// Swap chain images whose static bundles are out of date
+
+	// LATENCY
+	std::deque<FrameLatency> m_PendingLatencies;	// Submitted frames the GPU has not finished
+	double m_LatencySum = 0.0;					// Seconds of CPU to present latency since last log
+	double m_LatencyMax = 0.0;					// Worst latency since last log
+	uint32_t m_LatencyCount = 0;				// Frames measured since last log
+	std::chrono::high_resolution_clock::time_point m_PresentModeStart;	// When current present mode was chosen
+	uint32_t m_PresentModeFrames = 0;			// Frames presented in current present mode
+	double m_PresentModeLatencySum = 0.0;		// Seconds of latency in current present mode
+	uint32_t m_PresentModeLatencyCount = 0;		// Frames measured in current present mode
 
 	// FUNCTIONS
 	void InitWindow();			// Initialise GLFW and Window
+	void CreateFramePacer();	// Pace to configured frame rate or monitor refresh
 	void InitVulkan();			// Initialise Vulkan
 	void CreateInstance();		// Create Vulkan instance
 	void CreateSurface();		// Create Vulkan surface
 	void CreateDevice();		// Create device
-	void CreateSwapChain();		// Create Vulkan swap chain
+	void CreateSwapChain(VkSwapchainKHR oldSwapChain = VK_NULL_HANDLE);	// Create Vulkan swap chain, handing over images of old swap chain
 	void RecreateSwapChain();	// Recreate Vulkan swapchain (runtime)
 	void CleanupSwapChain();	// Clean swap chain
+	void CollectRenderGraphs(bool wait);	// Delete retired render graphs no frame or compile uses anymore, waiting for them if wait is true
+	void CreateOffscreenImages();	// Create images rendered to instead of a swap chain when headless
+	void CleanupImageResources();	// Destroy uniform buffers, descriptor sets and static bundles of swap chain images
 	void CreateImageViews();	// Create Vulkan image views
-	void CreateRenderPass();	// Create Vulkan rendering pass
-	void CreateDescriptorSetLayout();	// Create descriptor set layout
-	void CreateGraphicsPipeline();		// Create Vulkan graphics pipeline
+	void LoadShaders();					// Load scene shaders, reflected as they are loaded
+	void RegisterTextures();			// Give model texture a slot in the bindless table
+	void CreateDescriptorSetLayout();	// Create descriptor set and pipeline layouts from the scene shaders' reflection
+	void CreatePipelineCache();			// Load pipeline cache from disk
+	void CreatePipelineLibrary();		// Start compiling the pipelines used with the scene shaders
+	void CreateGraphicsPipeline();		// Scene pipeline from the library, waits only if its precompile has not finished
+	PipelineState GetScenePipelineState();	// State of pipeline drawing the model into the scene pass
+	void UpdateScenePipeline();			// Switch to scene pipeline variant of requested features once compiled
 	void CreateCommandPool();	// Create Vulkan command pool
-	void CreateColourResources();// Create and allocate resources for antialiasing
-	void CreateDepthResources();// Create and allocate resources for depth buffering
-	void CreateCommandBuffers();// Create command buffers for command pool
-	void CreateFramebuffers();	// Create frame buffers
+	void CreateDynamicResolution();	// Scale scene resolution to hold configured GPU frame rate
+	void CreateRenderGraph();	// Declare frame passes and create their render passes and attachments
+	void CreateCommandBuffers();// Create per frame command buffers
+	void CreateStaticBundles();	// Allocate static bundles for swap chain images, recorded on first use
+	void RecordStaticBundles(size_t i, uint32_t jobCount = 0);	// Record static geometry for swap chain image, 0 jobs uses every worker
+	void RecordDraws(VkCommandBuffer commandBuffer, size_t i, uint32_t firstDraw, uint32_t drawCount);	// Record range of draws into secondary command buffer
+	void RecordFrameCommands(uint32_t imageIndex);	// Record this frame's primary command buffer from its transient pool
 	void CreateSemaphores();	// Create semaphores
 	void CreateTextureSampler();// Create texture sampler
 	void LoadModel();			// Load in obj model
+	void CreateDefragmenter();	// Create defragmenter and register movable resources
 	void CreateUniformBuffers();// Create uniform buffers
-	void CreateDescriptorPool();// Create descriptor pool
+	void CreateDescriptorCache();// Create descriptor cache
 	void CreateDescriptorSets();// Create descriptor sets
+	void UpdateDescriptorSet(size_t i);		// Look up descriptors for swap chain image, written only if no set holds them yet
 	void DrawFrame();			// Draw frame with Vulkan
 	void UpdateUniformBuffer(uint32_t currentImage);	// Update uniform buffer for rotation
+	void UpdateLatency();		// Measure frames the GPU has finished since last call
+	void LogLatency();			// Print latency since last log and reset it
+	void LogPresentModeStats();	// Print frame rate and latency achieved in current present mode and reset them
 	void SetupDebugMessenger();	// Setup vulkan debug logger
 	
 	// ASSISTING FUNCTIONS
@@ -94,8 +177,8 @@ private:
 	VkPresentModeKHR ChooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes);		// Select appropriate presentation mode
 	VkExtent2D ChooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities);								// Choose resolution of swap chain images
 	static void FramebufferResizeCallback(GLFWwindow* window, int width, int height);
-	VkCommandBuffer BeginSingleTimeCommands();
-	void EndSingleTimeCommands(VkCommandBuffer commandBuffer);
+	static void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);	// P cycles present mode policy, T, C and A toggle shader features
+	static const char* GetPresentModeName(VkPresentModeKHR presentMode);	// Name of Vulkan present mode
 	VkFormat FindSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
 	VkFormat FindDepthFormat();							// Find suitable format for depth image
 	bool HasStencilComponent(VkFormat format);			// Check if format has stencil component
@@ -0,0 +1,183 @@
+#include "Benchmark.h"
+#include "Buffer.h"
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+// Constructor
+Benchmark::Benchmark(Device* device, CommandPool* commandPool) : m_Device(device), m_CommandPool(commandPool) {}
+
+// Compare upload bandwidth of staging and direct paths
+void Benchmark::RunUploads() {
+	bool directSupported = m_Device->GetAllocator()->SupportsDirectUpload();
+
+	for (VkDeviceSize size : BENCHMARK_UPLOAD_SIZES) {
+		// Source data
+		std::vector<char> data(static_cast<size_t>(size), 1);
+
+		// Best of several runs for each path
+		double stagingTime = TimeStagingUpload(data.data(), size);
+		double directTime = directSupported ? TimeDirectUpload(data.data(), size) : 0.0;
+		for (int i = 1; i < BENCHMARK_ITERATIONS; i++) {
+			stagingTime = std::min(stagingTime, TimeStagingUpload(data.data(), size));
+			if (directSupported) {
+				directTime = std::min(directTime, TimeDirectUpload(data.data(), size));
+			}
+		}
+
+		// Print bandwidth in MiB/s
+		double sizeMiB = static_cast<double>(size) / (1024.0 * 1024.0);
+		std::cout << std::fixed << std::setprecision(1) << "Upload " << sizeMiB << " MiB: staging " << sizeMiB / stagingTime << " MiB/s, direct ";
+		if (directSupported) {
+			std::cout << sizeMiB / directTime << " MiB/s";
+		}
+		else {
+			std::cout << "unsupported";
+		}
+		std::cout << std::defaultfloat << std::endl;
+	}
+}
+
+// Compare recording time of one job and every job against draw count
+void Benchmark::RunRecording(const std::function<void(uint32_t drawCount, uint32_t jobCount)>& record, uint32_t maxJobs) {
+	for (uint32_t drawCount : BENCHMARK_DRAW_COUNTS) {
+		// Best of several runs for one job and every job
+		double singleTime = 0.0;
+		double parallelTime = 0.0;
+		for (int i = 0; i < BENCHMARK_ITERATIONS; i++) {
+			double time = TimeRecording(record, drawCount, 1);
+			singleTime = (i == 0) ? time : std::min(singleTime, time);
+			time = TimeRecording(record, drawCount, maxJobs);
+			parallelTime = (i == 0) ? time : std::min(parallelTime, time);
+		}
+
+		// Print milliseconds and speedup
+		std::cout << std::fixed << std::setprecision(3) << "Record " << drawCount << " draws: 1 thread " << singleTime * 1000.0 << " ms, "
+			<< maxJobs << " threads " << parallelTime * 1000.0 << " ms (" << std::setprecision(2) << singleTime / parallelTime << "x)" << std::defaultfloat << std::endl;
+	}
+}
+
+// Measure task overhead, dependency latency and parallel for scaling
+void Benchmark::RunJobs(JobSystem* jobSystem) {
+	// Independent empty tasks measure scheduling and stealing overhead
+	double independentTime = 0.0;
+	double chainTime = 0.0;
+	for (int i = 0; i < BENCHMARK_ITERATIONS; i++) {
+		auto startTime = std::chrono::high_resolution_clock::now();
+		std::vector<JobHandle> jobs;
+		jobs.reserve(BENCHMARK_JOB_COUNT);
+		for (uint32_t j = 0; j < BENCHMARK_JOB_COUNT; j++) {
+			jobs.push_back(jobSystem->Schedule([]() {}));
+		}
+		for (const JobHandle& job : jobs) {
+			jobSystem->Wait(job);
+		}
+		auto endTime = std::chrono::high_resolution_clock::now();
+		double time = std::chrono::duration<double>(endTime - startTime).count();
+		independentTime = (i == 0) ? time : std::min(independentTime, time);
+
+		// Chain of dependent tasks measures latency of releasing a dependent
+		startTime = std::chrono::high_resolution_clock::now();
+		JobHandle previous = jobSystem->Schedule([]() {});
+		for (uint32_t j = 1; j < BENCHMARK_JOB_COUNT / 10; j++) {
+			previous = jobSystem->Schedule([]() {}, { previous });
+		}
+		jobSystem->Wait(previous);
+		endTime = std::chrono::high_resolution_clock::now();
+		time = std::chrono::duration<double>(endTime - startTime).count();
+		chainTime = (i == 0) ? time : std::min(chainTime, time);
+	}
+
+	std::cout << std::fixed << std::setprecision(3) << "Jobs " << BENCHMARK_JOB_COUNT << " independent: " << independentTime * 1e9 / BENCHMARK_JOB_COUNT << " ns per task, "
+		<< BENCHMARK_JOB_COUNT / 10 << " chained: " << chainTime * 1e9 / (BENCHMARK_JOB_COUNT / 10) << " ns per task" << std::defaultfloat << std::endl;
+
+	// Parallel for over a memory and compute bound sum, one task against one per thread and finer
+	std::vector<float> values(BENCHMARK_JOB_ELEMENTS);
+	for (uint32_t i = 0; i < BENCHMARK_JOB_ELEMENTS; i++) {
+		values[i] = static_cast<float>(i % 1024);
+	}
+
+	uint32_t threadCount = jobSystem->GetThreadCount();
+	double singleTime = 0.0;
+	double threadTime = 0.0;
+	double fineTime = 0.0;
+	for (int i = 0; i < BENCHMARK_ITERATIONS; i++) {
+		double time = TimeParallelSum(jobSystem, values, 1);
+		singleTime = (i == 0) ? time : std::min(singleTime, time);
+		time = TimeParallelSum(jobSystem, values, threadCount);
+		threadTime = (i == 0) ? time : std::min(threadTime, time);
+		time = TimeParallelSum(jobSystem, values, threadCount * 16);
+		fineTime = (i == 0) ? time : std::min(fineTime, time);
+	}
+
+	std::cout << std::fixed << std::setprecision(3) << "Parallel for " << BENCHMARK_JOB_ELEMENTS << " elements: 1 task " << singleTime * 1000.0 << " ms, "
+		<< threadCount << " tasks " << threadTime * 1000.0 << " ms (" << std::setprecision(2) << singleTime / threadTime << "x), " << std::setprecision(3)
+		<< threadCount * 16 << " tasks " << fineTime * 1000.0 << " ms (" << std::setprecision(2) << singleTime / fineTime << "x)" << std::defaultfloat << std::endl;
+}
+
+// Seconds to sum values split into tasks
+double Benchmark::TimeParallelSum(JobSystem* jobSystem, const std::vector<float>& values, uint32_t taskCount) {
+	std::vector<double> sums(taskCount, 0.0);
+	uint32_t elementsPerTask = (static_cast<uint32_t>(values.size()) + taskCount - 1) / taskCount;
+
+	auto startTime = std::chrono::high_resolution_clock::now();
+	jobSystem->ParallelFor(taskCount, [&](uint32_t task) {
+		size_t first = static_cast<size_t>(task) * elementsPerTask;
+		size_t last = std::min(first + elementsPerTask, values.size());
+		double sum = 0.0;
+		for (size_t i = first; i < last; i++) {
+			sum += std::sqrt(values[i]);
+		}
+		sums[task] = sum;
+	});
+	auto endTime = std::chrono::high_resolution_clock::now();
+
+	// Use result so the loop is not optimised away
+	volatile double total = 0.0;
+	for (double sum : sums) {
+		total = total + sum;
+	}
+
+	return std::chrono::duration<double>(endTime - startTime).count();
+}
+
+// Seconds to record draws with given number of jobs
+double Benchmark::TimeRecording(const std::function<void(uint32_t drawCount, uint32_t jobCount)>& record, uint32_t drawCount, uint32_t jobCount) {
+	auto startTime = std::chrono::high_resolution_clock::now();
+	record(drawCount, jobCount);
+	auto endTime = std::chrono::high_resolution_clock::now();
+
+	return std::chrono::duration<double>(endTime - startTime).count();
+}
+
+// Seconds to upload through a staging buffer
+double Benchmark::TimeStagingUpload(const void* data, VkDeviceSize size) {
+	// Buffers outside timing
+	Buffer stagingBuffer(m_Device, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	Buffer buffer(m_Device, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	// Time host write and GPU copy
+	auto startTime = std::chrono::high_resolution_clock::now();
+	stagingBuffer.Upload(data, size);
+	buffer.CopyToBuffer(m_CommandPool, stagingBuffer.GetBuffer(), size);
+	auto endTime = std::chrono::high_resolution_clock::now();
+
+	return std::chrono::duration<double>(endTime - startTime).count();
+}
+
+// Seconds to write device local host visible memory
+double Benchmark::TimeDirectUpload(const void* data, VkDeviceSize size) {
+	// Buffer outside timing
+	Buffer buffer(m_Device, size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+	// Time host write, coherent memory needs no flush
+	auto startTime = std::chrono::high_resolution_clock::now();
+	buffer.Upload(data, size);
+	auto endTime = std::chrono::high_resolution_clock::now();
+
+	return std::chrono::duration<double>(endTime - startTime).count();
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "vulkan/vulkan.h"
+
+#include "CommandPool.h"
+#include "Device.h"
+#include "JobSystem.h"
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Upload sizes measured by the upload benchmark
+const VkDeviceSize BENCHMARK_UPLOAD_SIZES[] = { 1ull * 1024 * 1024, 16ull * 1024 * 1024, 64ull * 1024 * 1024 };
+
+// Draw counts measured by the recording benchmark
+const uint32_t BENCHMARK_DRAW_COUNTS[] = { 1, 100, 1000, 10000, 100000 };
+
+// Tasks scheduled by the job scheduling benchmarks
+const uint32_t BENCHMARK_JOB_COUNT = 100000;
+
+// Elements summed by the parallel for benchmark
+const uint32_t BENCHMARK_JOB_ELEMENTS = 1u << 24;
+
+// Repetitions of each measurement
+const int BENCHMARK_ITERATIONS = 10;
+
+// Micro benchmarks run with --benchmark
+class Benchmark {
+public:
+	Benchmark(Device* device, CommandPool* commandPool);	// Constructor
+
+	// FUNCTIONS
+	void RunUploads();		// Compare upload bandwidth of staging and direct paths
+	void RunRecording(const std::function<void(uint32_t drawCount, uint32_t jobCount)>& record, uint32_t maxJobs);	// Compare recording time of one job and every job against draw count
+	void RunJobs(JobSystem* jobSystem);	// Measure task overhead, dependency latency and parallel for scaling
+private:
+	// VARIABLES
+	Device* m_Device;				// Device object
+	CommandPool* m_CommandPool;		// Command pool for copy commands
+
+	// FUNCTIONS
+	double TimeStagingUpload(const void* data, VkDeviceSize size);	// Seconds to upload through a staging buffer
+	double TimeDirectUpload(const void* data, VkDeviceSize size);	// Seconds to write device local host visible memory
+	double TimeParallelSum(JobSystem* jobSystem, const std::vector<float>& values, uint32_t taskCount);	// Seconds to sum values split into tasks
+	double TimeRecording(const std::function<void(uint32_t drawCount, uint32_t jobCount)>& record, uint32_t drawCount, uint32_t jobCount);	// Seconds to record draws with given number of jobs
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "vulkan/vulkan.h"
+
+#include <vector>
+
+#include "Device.h"
+
+// Most textures the bindless table holds, lowered to the device limit
+const uint32_t BINDLESS_TEXTURE_CAPACITY = 4096;
+
+// Every texture in one update after bind descriptor set, selected per draw by index
+class BindlessTextures {
+public:
+	BindlessTextures(Device* device, uint32_t capacity = BINDLESS_TEXTURE_CAPACITY);	// Constructor
+	~BindlessTextures();					// Destructor
+
+	// FUNCTIONS
+	uint32_t Add(VkImageView imageView, VkSampler sampler);	// Write texture into a free slot and return its index
+	void Remove(uint32_t index);			// Free slot, no submitted work may still use it
+
+	// GETTERS
+	VkDescriptorSetLayout GetSetLayout() { return m_SetLayout; }
+	VkDescriptorSet GetDescriptorSet() { return m_DescriptorSet; }
+	uint32_t GetCapacity() { return m_Capacity; }
+private:
+	// VARIABLES
+	Device* m_Device;						// Device object
+	uint32_t m_Capacity;					// Slots in array
+	VkDescriptorSetLayout m_SetLayout;		// Layout of texture array
+	VkDescriptorPool m_DescriptorPool;		// Update after bind pool of the set
+	VkDescriptorSet m_DescriptorSet;		// Texture array
+	std::vector<uint32_t> m_FreeSlots;		// Removed slots to reuse
+	uint32_t m_NextSlot;					// First never used slot
+};
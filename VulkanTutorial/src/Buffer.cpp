@@ -4,7 +4,7 @@
 
 // Constructor
 Buffer::Buffer(Device* device, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, BufferType bufferType)
-	: m_BufferType(bufferType), m_Device(device) {
+	: m_BufferType(bufferType), m_Device(device), m_Size(size), m_Usage(usage), m_Properties(properties) {
 
 	// Buffer creation info
 	VkBufferCreateInfo bufferInfo = {};
@@ -22,19 +22,31 @@ Buffer::Buffer(Device* device, VkDeviceSize size, VkBufferUsageFlags usage, VkMe
 	VkMemoryRequirements memRequirements;
 	vkGetBufferMemoryRequirements(m_Device->GetDevice(), m_Buffer, &memRequirements);
 
-	// Allocation info
-	VkMemoryAllocateInfo allocInfo = {};
-	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocInfo.allocationSize = memRequirements.size;
-	allocInfo.memoryTypeIndex = FindMemoryType(memRequirements.memoryTypeBits, properties);
+	// Account memory by what the buffer is used for
+	MemoryCategory category = MEMORY_CATEGORY_OTHER;
+	switch (m_BufferType) {
+	case BUFFER_VERTEX: category = MEMORY_CATEGORY_VERTEX; break;
+	case BUFFER_INDEX: category = MEMORY_CATEGORY_INDEX; break;
+	case BUFFER_UNIFORM: category = MEMORY_CATEGORY_UNIFORM; break;
+	default:
+		if (usage == VK_BUFFER_USAGE_TRANSFER_SRC_BIT) {
+			category = MEMORY_CATEGORY_STAGING;
+		}
+		break;
+	}
 
-	// Allocate memory
-	if (vkAllocateMemory(m_Device->GetDevice(), &allocInfo, nullptr, &m_BufferMemory) != VK_SUCCESS) {
-		throw std::runtime_error("Failed to allocate buffer memory");
+	// Allocate memory, host visible device local buffers from the large heap direct upload was detected on
+	VkMemoryPropertyFlags directFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+	uint32_t memoryTypeIndex;
+	if ((properties & directFlags) == directFlags && m_Device->GetAllocator()->FindDirectUploadMemoryType(memRequirements.memoryTypeBits, memoryTypeIndex)) {
+		m_Allocation = m_Device->GetAllocator()->AllocateOfType(memRequirements, memoryTypeIndex, category);
+	}
+	else {
+		m_Allocation = m_Device->GetAllocator()->Allocate(memRequirements, properties, category);
 	}
 
 	// Bind buffer to memory
-	vkBindBufferMemory(m_Device->GetDevice(), m_Buffer, m_BufferMemory, 0);
+	vkBindBufferMemory(m_Device->GetDevice(), m_Buffer, m_Allocation.memory, m_Allocation.offset);
 
 }
 
@@ -42,50 +54,30 @@ Buffer::Buffer(Device* device, VkDeviceSize size, VkBufferUsageFlags usage, VkMe
 Buffer::~Buffer(){
 	// Destroy vertex buffer and free memory
 	vkDestroyBuffer(m_Device->GetDevice(), m_Buffer, nullptr);
-	vkFreeMemory(m_Device->GetDevice(), m_BufferMemory, nullptr);
+	m_Device->GetAllocator()->Free(m_Allocation);
 }
 
 // Copy data to buffer
-void Buffer::CopyToBuffer(VkCommandPool commandPool, VkBuffer srcBuffer, VkDeviceSize size){
-
-	// Command buffer allocation info
-	VkCommandBufferAllocateInfo allocInfo = {};
-	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	allocInfo.commandPool = commandPool;
-	allocInfo.commandBufferCount = 1;
-
-	// Create command buffer
-	VkCommandBuffer commandBuffer;
-	vkAllocateCommandBuffers(m_Device->GetDevice(), &allocInfo, &commandBuffer);
-
-	// Start recording command buffer
-	VkCommandBufferBeginInfo beginInfo = {};
-	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+void Buffer::CopyToBuffer(CommandPool* commandPool, VkBuffer srcBuffer, VkDeviceSize size){
+	VkCommandBuffer commandBuffer = commandPool->BeginSingleTimeCommands();
+	CopyToBuffer(commandBuffer, srcBuffer, size);
+	commandPool->EndSingleTimeCommands(commandBuffer);
+}
 
+// Record copy of data to buffer
+void Buffer::CopyToBuffer(VkCommandBuffer commandBuffer, VkBuffer srcBuffer, VkDeviceSize size){
 	// Create copy buffer command
 	VkBufferCopy copyRegion = {};
 	copyRegion.srcOffset = 0;
 	copyRegion.dstOffset = 0;
 	copyRegion.size = size;
 	vkCmdCopyBuffer(commandBuffer, srcBuffer, m_Buffer, 1, &copyRegion);
+}
 
-	// End command buffer
-	vkEndCommandBuffer(commandBuffer);
-
-	// Submit command buffer
-	VkSubmitInfo submitInfo = {};
-	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &commandBuffer;
-	vkQueueSubmit(m_Device->GetGraphicsQueue(), 1, &submitInfo, VK_NULL_HANDLE);
-	vkQueueWaitIdle(m_Device->GetGraphicsQueue());
-
-	// Free command buffers
-	vkFreeCommandBuffers(m_Device->GetDevice(), commandPool, 1, &commandBuffer);
-
+// Write data through persistent mapping
+void Buffer::Upload(const void* data, VkDeviceSize size){
+	// Mapped device local memory is write combined: one sequential pass, never read back
+	memcpy(m_Allocation.mappedData, data, static_cast<size_t>(size));
 }
 
 void Buffer::Bind(VkCommandBuffer commandBuffer){
@@ -105,18 +97,9 @@ void Buffer::Bind(VkCommandBuffer commandBuffer){
 	}
 }
 
-// Find appropriate memory type
-uint32_t Buffer::FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
-	// Get memory properties
-	VkPhysicalDeviceMemoryProperties memProperties;
-	vkGetPhysicalDeviceMemoryProperties(m_Device->GetPhysicalDevice(), &memProperties);
-
-	// Find suitable memory type
-	for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
-		if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
-			return i;
-		}
-	}
-
-	throw std::runtime_error("Failed to find suitable memory type!");
+// True if defragmentation may move buffer
+bool Buffer::IsRelocatable() {
+	// Needs to be copyable and not mapped by the host
+	VkBufferUsageFlags transferUsage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	return (m_Usage & transferUsage) == transferUsage && !(m_Properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
 }
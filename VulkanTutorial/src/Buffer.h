@@ -1,7 +1,9 @@
 #pragma once
 
 #include "vulkan/vulkan.h"
+#include "CommandPool.h"
 #include "Device.h"
+#include "MemoryAllocator.h"
 
 typedef enum BufferType {
 	BUFFER_UNDEFINED,
@@ -15,18 +17,25 @@ public:
 	Buffer(Device* device, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, BufferType bufferType = BUFFER_UNDEFINED);
 	~Buffer();
 	
-	void CopyToBuffer(VkCommandPool commandPool, VkBuffer srcBuffer, VkDeviceSize size);		// Copy data to buffer
+	void CopyToBuffer(CommandPool* commandPool, VkBuffer srcBuffer, VkDeviceSize size);			// Copy data to buffer
+	void CopyToBuffer(VkCommandBuffer commandBuffer, VkBuffer srcBuffer, VkDeviceSize size);	// Record copy of data to buffer
+	void Upload(const void* data, VkDeviceSize size);	// Write data through persistent mapping
 	void Bind(VkCommandBuffer commandBuffer);		// Bind buffer to commandbuffer
+	bool IsRelocatable();							// True if defragmentation may move buffer
 
 	VkBuffer GetBuffer() { return m_Buffer; }
-	VkDeviceMemory GetBufferMemory() { return m_BufferMemory; }
+	VkDeviceSize GetSize() { return m_Size; }
+	void* GetMappedData() { return m_Allocation.mappedData; }
+	const Allocation& GetAllocation() { return m_Allocation; }
 private:
 	// VARIABLES
 	BufferType m_BufferType;			// Buffer type
 	Device* m_Device;					// Vulkan device
 	VkBuffer m_Buffer;					// Vulkan buffer object
-	VkDeviceMemory m_BufferMemory;		// Buffer allocated memory
+	VkDeviceSize m_Size;				// Buffer size
+	VkBufferUsageFlags m_Usage;			// Buffer usage
+	VkMemoryPropertyFlags m_Properties;	// Buffer memory properties
+	Allocation m_Allocation;			// Buffer allocated memory
 
-	// FUNCTIONS
-	uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);		// Find appropriate memory type
-};
\ No newline at end of file
+	friend class Defragmenter;			// Defragmenter swaps buffer and memory when relocating
+};
@@ -3,13 +3,12 @@
 #include <stdexcept>
 
 // Constructor
-CommandPool::CommandPool(Device* device) : m_Device(device) {
+CommandPool::CommandPool(Device* device, VkCommandPoolCreateFlags flags, QueueType queueType) : m_Device(device), m_Timeline(device->GetTimeline(queueType)) {
 	// Command pool creation info
-	QueueFamilyIndices queueFamilyIndices = m_Device->FindQueueFamilies(m_Device->GetPhysicalDevice());
 	VkCommandPoolCreateInfo poolInfo = {};
 	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-	poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
-	poolInfo.flags = 0;
+	poolInfo.queueFamilyIndex = m_Device->GetQueueFamily(queueType);
+	poolInfo.flags = flags;
 
 	// Create command pool
 	if (vkCreateCommandPool(m_Device->GetDevice(), &poolInfo, nullptr, &m_CommandPool) != VK_SUCCESS) {
@@ -19,37 +18,69 @@ CommandPool::CommandPool(Device* device) : m_Device(device) {
 
 // Destructor
 CommandPool::~CommandPool() {
-	// Destroy command pool
+	// Wait for immediate submissions
+	for (ImmediateCommands& immediate : m_Immediate) {
+		Wait(immediate.submission);
+	}
+
+	// Destroy command pool, freeing its command buffers
 	vkDestroyCommandPool(m_Device->GetDevice(), m_CommandPool, nullptr);
 }
 
 // Begin single time command
 VkCommandBuffer CommandPool::BeginSingleTimeCommands() {
-	// Command buffer allocation info
-	VkCommandBufferAllocateInfo allocInfo = {};
-	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	allocInfo.commandPool = m_CommandPool;
-	allocInfo.commandBufferCount = 1;
+	// Reuse a command buffer whose last submission has finished
+	ImmediateCommands* immediate = nullptr;
+	for (ImmediateCommands& candidate : m_Immediate) {
+		if (!candidate.recording && IsComplete(candidate.submission)) {
+			immediate = &candidate;
+			break;
+		}
+	}
+
+	// Otherwise grow the pool
+	if (immediate == nullptr) {
+		ImmediateCommands newImmediate = {};
+
+		// Command buffer allocation info
+		VkCommandBufferAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandPool = m_CommandPool;
+		allocInfo.commandBufferCount = 1;
+
+		// Allocate command buffer
+		if (vkAllocateCommandBuffers(m_Device->GetDevice(), &allocInfo, &newImmediate.commandBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to allocate command buffers!");
+		}
 
-	// Allocate command buffer
-	VkCommandBuffer commandBuffer;
-	vkAllocateCommandBuffers(m_Device->GetDevice(), &allocInfo, &commandBuffer);
+		m_Immediate.push_back(newImmediate);
+		immediate = &m_Immediate.back();
+	}
+
+	immediate->recording = true;
 
 	// Begin info
 	VkCommandBufferBeginInfo beginInfo = {};
 	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
-	// Begin command buffer
-	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+	// Begin command buffer, implicitly resetting it
+	vkBeginCommandBuffer(immediate->commandBuffer, &beginInfo);
 
 	// Return command buffer
-	return commandBuffer;
+	return immediate->commandBuffer;
 }
 
-// End signle time commands
+// End signle time commands and wait for them
 void CommandPool::EndSingleTimeCommands(VkCommandBuffer commandBuffer) {
+	Wait(Submit(commandBuffer));
+}
+
+// End single time commands and submit without waiting
+SubmissionId CommandPool::Submit(VkCommandBuffer commandBuffer) {
+	ImmediateCommands& immediate = FindImmediate(commandBuffer);
+
 	// End command buffer
 	vkEndCommandBuffer(commandBuffer);
 
@@ -59,10 +90,63 @@ void CommandPool::EndSingleTimeCommands(VkCommandBuffer commandBuffer) {
 	submitInfo.commandBufferCount = 1;
 	submitInfo.pCommandBuffers = &commandBuffer;
 
-	// Submit to queue
-	vkQueueSubmit(m_Device->GetGraphicsQueue(), 1, &submitInfo, VK_NULL_HANDLE);
-	vkQueueWaitIdle(m_Device->GetGraphicsQueue());
+	// Submit to queue, its timeline signals completion
+	immediate.submission = m_Timeline->Submit(submitInfo);
+	immediate.recording = false;
+	return immediate.submission;
+}
+
+// True if submission has finished on the GPU
+bool CommandPool::IsComplete(SubmissionId submission) {
+	return m_Timeline->IsComplete(submission);
+}
+
+// Block until submission has finished
+void CommandPool::Wait(SubmissionId submission) {
+	m_Timeline->Wait(submission);
+}
 
-	// Free command buffer
-	vkFreeCommandBuffers(m_Device->GetDevice(), m_CommandPool, 1, &commandBuffer);
-}
\ No newline at end of file
+// Allocate command buffers owned by caller
+std::vector<VkCommandBuffer> CommandPool::AllocateCommandBuffers(uint32_t count, VkCommandBufferLevel level) {
+	std::vector<VkCommandBuffer> commandBuffers(count);
+
+	// Command buffer allocation info
+	VkCommandBufferAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.commandPool = m_CommandPool;
+	allocInfo.level = level;
+	allocInfo.commandBufferCount = count;
+
+	// Allocate command buffers
+	if (count > 0 && vkAllocateCommandBuffers(m_Device->GetDevice(), &allocInfo, commandBuffers.data()) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to allocate command buffers!");
+	}
+
+	return commandBuffers;
+}
+
+// Free command buffers from AllocateCommandBuffers
+void CommandPool::FreeCommandBuffers(std::vector<VkCommandBuffer>& commandBuffers) {
+	if (!commandBuffers.empty()) {
+		vkFreeCommandBuffers(m_Device->GetDevice(), m_CommandPool, static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
+	}
+	commandBuffers.clear();
+}
+
+// Return every command buffer to the initial state, none may be pending
+void CommandPool::Reset() {
+	if (vkResetCommandPool(m_Device->GetDevice(), m_CommandPool, 0) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to reset command pool!");
+	}
+}
+
+// Slot owning command buffer
+CommandPool::ImmediateCommands& CommandPool::FindImmediate(VkCommandBuffer commandBuffer) {
+	for (ImmediateCommands& immediate : m_Immediate) {
+		if (immediate.commandBuffer == commandBuffer) {
+			return immediate;
+		}
+	}
+
+	throw std::invalid_argument("Command buffer was not begun by this command pool!");
+}
@@ -3,20 +3,44 @@
 #include "vulkan/vulkan.h"
 #include "Device.h"
 
+#include <vector>
+
+// Timeline value of an immediate submission on the pool's queue, 0 is never used
+typedef uint64_t SubmissionId;
+
 class CommandPool {
 public:
-	CommandPool(Device* device);		// Constructor
+	CommandPool(Device* device, VkCommandPoolCreateFlags flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT, QueueType queueType = QUEUE_TYPE_GRAPHICS);		// Constructor
 	~CommandPool();						// Destructor
 
 	// FUNCTIONS
 	VkCommandBuffer BeginSingleTimeCommands();					// Begin single time command
-	void EndSingleTimeCommands(VkCommandBuffer commandBuffer);	// End signle time commands
+	void EndSingleTimeCommands(VkCommandBuffer commandBuffer);	// End signle time commands and wait for them
+	SubmissionId Submit(VkCommandBuffer commandBuffer);			// End single time commands and submit without waiting
+	bool IsComplete(SubmissionId submission);					// True if submission has finished on the GPU
+	void Wait(SubmissionId submission);							// Block until submission has finished
+	std::vector<VkCommandBuffer> AllocateCommandBuffers(uint32_t count, VkCommandBufferLevel level);	// Allocate command buffers owned by caller
+	void FreeCommandBuffers(std::vector<VkCommandBuffer>& commandBuffers);							// Free command buffers from AllocateCommandBuffers
+	void Reset();												// Return every command buffer to the initial state, none may be pending
 
 	// GETTERS
 	VkCommandPool GetCommandPool() { return m_CommandPool; }
+	QueueTimeline* GetTimeline() { return m_Timeline; }
 
 private:
+	// STRUCTS
+	struct ImmediateCommands {
+		VkCommandBuffer commandBuffer;		// Resettable command buffer
+		SubmissionId submission;			// Last submission, 0 if none
+		bool recording;						// True between begin and submit
+	};
+
 	// VARIABLES
 	VkCommandPool m_CommandPool;		// Vulkan command pool
 	Device* m_Device;					// Vulkan device	
-};
\ No newline at end of file
+	QueueTimeline* m_Timeline;			// Timeline of queue command buffers are submitted to
+	std::vector<ImmediateCommands> m_Immediate;	// Reusable single time command buffers
+
+	// FUNCTIONS
+	ImmediateCommands& FindImmediate(VkCommandBuffer commandBuffer);	// Slot owning command buffer
+};
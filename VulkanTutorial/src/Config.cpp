@@ -0,0 +1,111 @@
+#include "Config.h"
+
+#include <stdexcept>
+#include <string>
+
+// Parse positive integer value of option
+static uint32_t ParseCount(const std::string& option, const char* value) {
+	if (value == nullptr) {
+		throw std::invalid_argument(option + " needs a value!");
+	}
+
+	// Whole string must be a number of at least one
+	size_t length = 0;
+	unsigned long count = 0;
+	try {
+		count = std::stoul(value, &length);
+	}
+	catch (const std::exception&) {
+		length = 0;
+	}
+	if (length == 0 || value[length] != '\0' || count == 0 || count > UINT32_MAX) {
+		throw std::invalid_argument(option + " must be a positive integer!");
+	}
+	return static_cast<uint32_t>(count);
+}
+
+// Parse present mode policy by name
+static PresentModePolicy ParsePresentModePolicy(const std::string& option, const char* value) {
+	if (value == nullptr) {
+		throw std::invalid_argument(option + " needs a value!");
+	}
+
+	for (int policy = 0; policy < PRESENT_MODE_POLICY_COUNT; policy++) {
+		if (GetPresentModePolicyName(static_cast<PresentModePolicy>(policy)) == std::string(value)) {
+			return static_cast<PresentModePolicy>(policy);
+		}
+	}
+	throw std::invalid_argument(option + " must be auto, fifo, fifo-relaxed, mailbox or immediate!");
+}
+
+// Read settings from command line, throws on invalid arguments
+ApplicationConfig ParseCommandLine(int argc, char** argv) {
+	ApplicationConfig config;
+
+	for (int i = 1; i < argc; i++) {
+		std::string option = argv[i];
+		const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+
+		if (option == "--benchmark") {
+			config.benchmark = true;
+		}
+		else if (option == "--frames-in-flight") {
+			config.framesInFlight = ParseCount(option, value);
+			i++;
+		}
+		else if (option == "--swapchain-images") {
+			config.swapChainImages = ParseCount(option, value);
+			i++;
+		}
+		else if (option == "--fps") {
+			config.targetFrameRate = ParseCount(option, value);
+			i++;
+		}
+		else if (option == "--resolution-fps") {
+			config.resolutionTargetFrameRate = ParseCount(option, value);
+			i++;
+		}
+		else if (option == "--refresh-locked") {
+			config.refreshLocked = true;
+		}
+		else if (option == "--headless") {
+			config.headless = true;
+		}
+		else if (option == "--frames") {
+			config.frameCount = ParseCount(option, value);
+			i++;
+		}
+		else if (option == "--present-mode") {
+			config.presentMode = ParsePresentModePolicy(option, value);
+			i++;
+		}
+		else {
+			throw std::invalid_argument("Unknown option " + option + "!");
+		}
+	}
+
+	// Headless runs have no window to close
+	if (config.headless && config.frameCount == 0) {
+		config.frameCount = DEFAULT_HEADLESS_FRAMES;
+	}
+
+	return config;
+}
+
+// Name of policy as given on the command line
+const char* GetPresentModePolicyName(PresentModePolicy policy) {
+	switch (policy) {
+	case PRESENT_MODE_POLICY_AUTO:
+		return "auto";
+	case PRESENT_MODE_POLICY_FIFO:
+		return "fifo";
+	case PRESENT_MODE_POLICY_FIFO_RELAXED:
+		return "fifo-relaxed";
+	case PRESENT_MODE_POLICY_MAILBOX:
+		return "mailbox";
+	case PRESENT_MODE_POLICY_IMMEDIATE:
+		return "immediate";
+	default:
+		return "unknown";
+	}
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+
+// Frames recorded ahead of the GPU by default
+const uint32_t DEFAULT_FRAMES_IN_FLIGHT = 2;
+
+// Frames rendered by headless runs without a frame count
+const uint32_t DEFAULT_HEADLESS_FRAMES = 1000;
+
+// How swap chain images are queued for presentation
+typedef enum PresentModePolicy {
+	PRESENT_MODE_POLICY_AUTO,			// Mailbox when available, otherwise FIFO
+	PRESENT_MODE_POLICY_FIFO,			// Wait for vertical blank, never tears
+	PRESENT_MODE_POLICY_FIFO_RELAXED,	// Wait for vertical blank unless the frame is late
+	PRESENT_MODE_POLICY_MAILBOX,		// Replace queued image, lowest latency without tearing
+	PRESENT_MODE_POLICY_IMMEDIATE,		// Present at once, measures raw throughput
+	PRESENT_MODE_POLICY_COUNT
+} PresentModePolicy;
+
+// Runtime settings chosen per deployment
+struct ApplicationConfig {
+	uint32_t framesInFlight = DEFAULT_FRAMES_IN_FLIGHT;	// Frames the CPU may record before waiting on the GPU, more for throughput, fewer for latency
+	uint32_t swapChainImages = 0;						// Requested swap chain images, 0 uses one more than the surface minimum
+	uint32_t targetFrameRate = 0;						// Frames per second the pacer aims for, 0 is unlimited
+	bool refreshLocked = false;							// Pace frames to the monitor refresh rate instead of targetFrameRate
+	uint32_t resolutionTargetFrameRate = 0;				// GPU frame rate dynamic resolution holds, 0 always renders at output resolution
+	PresentModePolicy presentMode = PRESENT_MODE_POLICY_AUTO;	// Present mode at startup, P cycles it at runtime
+	bool benchmark = false;								// Run micro benchmarks instead of rendering
+	bool headless = false;								// Render offscreen without window, surface or swap chain
+	uint32_t frameCount = 0;							// Frames to render before exiting, 0 runs until the window closes or DEFAULT_HEADLESS_FRAMES headless
+};
+
+// FUNCTIONS
+ApplicationConfig ParseCommandLine(int argc, char** argv);	// Read settings from command line, throws on invalid arguments
+const char* GetPresentModePolicyName(PresentModePolicy policy);	// Name of policy as given on the command line
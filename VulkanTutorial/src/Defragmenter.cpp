@@ -0,0 +1,385 @@
+#include "Defragmenter.h"
+
+#include <stdexcept>
+#include <algorithm>
+
+// Constructor
+Defragmenter::Defragmenter(Device* device, CommandPool* commandPool)
+	: m_Device(device), m_CommandPool(commandPool), m_Submission(0) {}
+
+// Destructor
+Defragmenter::~Defragmenter() {
+	// Finish outstanding work and destroy old resources
+	Flush();
+}
+
+// Allow buffer to be moved
+void Defragmenter::Register(Buffer* buffer) {
+	m_Buffers.push_back(buffer);
+}
+
+// Allow image to be moved
+void Defragmenter::Register(Image* image) {
+	m_Images.push_back(image);
+}
+
+// Stop moving buffer
+void Defragmenter::Unregister(Buffer* buffer) {
+	// Finish move in flight so buffer owns its final memory
+	for (const Move& move : m_Moves) {
+		if (move.buffer == buffer) {
+			m_CommandPool->Wait(m_Submission);
+			CommitMoves();
+			break;
+		}
+	}
+
+	m_Buffers.erase(std::remove(m_Buffers.begin(), m_Buffers.end(), buffer), m_Buffers.end());
+	m_MovedBuffers.erase(std::remove(m_MovedBuffers.begin(), m_MovedBuffers.end(), buffer), m_MovedBuffers.end());
+}
+
+// Stop moving image
+void Defragmenter::Unregister(Image* image) {
+	// Finish move in flight so image owns its final memory
+	for (const Move& move : m_Moves) {
+		if (move.image == image) {
+			m_CommandPool->Wait(m_Submission);
+			CommitMoves();
+			break;
+		}
+	}
+
+	m_Images.erase(std::remove(m_Images.begin(), m_Images.end(), image), m_Images.end());
+	m_MovedImages.erase(std::remove(m_MovedImages.begin(), m_MovedImages.end(), image), m_MovedImages.end());
+}
+
+// Advance by one step, returns true and the moved resources if bindings need patching
+bool Defragmenter::Update(std::vector<Buffer*>& movedBuffers, std::vector<Image*>& movedImages) {
+	// Poll copies in flight without blocking the frame
+	if (!m_Moves.empty()) {
+		if (m_CommandPool->IsComplete(m_Submission)) {
+			CommitMoves();
+		}
+	}
+	else {
+		// Start draining the sparsest block
+		MemoryBlock* block = FindSparseBlock();
+		if (block != nullptr) {
+			BeginMoves(block);
+		}
+	}
+
+	// Report moves committed here or by Unregister since the last update
+	movedBuffers.swap(m_MovedBuffers);
+	movedImages.swap(m_MovedImages);
+	m_MovedBuffers.clear();
+	m_MovedImages.clear();
+	return !movedBuffers.empty() || !movedImages.empty();
+}
+
+// Finish pending moves and destroy old resources, device must be idle
+bool Defragmenter::Flush() {
+	bool moved = false;
+
+	// Wait for copies in flight
+	if (!m_Moves.empty()) {
+		m_CommandPool->Wait(m_Submission);
+		CommitMoves();
+		moved = true;
+	}
+
+	// Destroy all old resources
+	m_Device->GetGraphicsTimeline()->CollectGarbage();
+
+	return moved;
+}
+
+// Find block worth draining
+MemoryBlock* Defragmenter::FindSparseBlock() {
+	MemoryAllocator* allocator = m_Device->GetAllocator();
+	MemoryBlock* sparsestBlock = nullptr;
+	float lowestUsage = DEFRAG_SPARSE_THRESHOLD;
+
+	// Check blocks of every memory type
+	for (uint32_t type = 0; type < allocator->GetMemoryTypeCount(); type++) {
+		const std::vector<MemoryBlock*>& blocks = allocator->GetBlocks(type);
+
+		// Free space across shared blocks of this type
+		VkDeviceSize totalFree = 0;
+		for (const MemoryBlock* block : blocks) {
+			if (!block->dedicated) {
+				totalFree += block->size - block->usedSize;
+			}
+		}
+
+		for (MemoryBlock* block : blocks) {
+			if (block->dedicated || block->allocationCount == 0) {
+				continue;
+			}
+
+			// Skip blocks that are dense or whose contents don't fit elsewhere
+			float usage = static_cast<float>(block->usedSize) / static_cast<float>(block->size);
+			VkDeviceSize freeElsewhere = totalFree - (block->size - block->usedSize);
+			if (usage >= lowestUsage || freeElsewhere < block->usedSize) {
+				continue;
+			}
+
+			// Skip blocks without anything we are allowed to move
+			bool hasRelocatable = false;
+			for (Buffer* buffer : m_Buffers) {
+				hasRelocatable |= buffer->m_Allocation.block == block && buffer->IsRelocatable();
+			}
+			for (Image* image : m_Images) {
+				hasRelocatable |= image->m_Allocation.block == block && image->IsRelocatable();
+			}
+
+			if (hasRelocatable) {
+				lowestUsage = usage;
+				sparsestBlock = block;
+			}
+		}
+	}
+
+	return sparsestBlock;
+}
+
+// Record and submit copies out of block
+void Defragmenter::BeginMoves(MemoryBlock* block) {
+	// Create destinations for buffers until the step budget is used
+	VkDeviceSize bytesMoved = 0;
+	bool full = false;
+	for (Buffer* buffer : m_Buffers) {
+		if (buffer->m_Allocation.block != block || !buffer->IsRelocatable()) {
+			continue;
+		}
+		if (bytesMoved + buffer->m_Allocation.size > DEFRAG_MAX_BYTES_PER_STEP && !m_Moves.empty()) {
+			full = true;
+			break;
+		}
+
+		Move move;
+		if (!PrepareBufferMove(buffer, move)) {
+			full = true;
+			break;
+		}
+		m_Moves.push_back(move);
+		bytesMoved += buffer->m_Allocation.size;
+	}
+
+	// Images use what is left of the budget
+	for (Image* image : m_Images) {
+		if (full) {
+			break;
+		}
+		if (image->m_Allocation.block != block || !image->IsRelocatable()) {
+			continue;
+		}
+		if (bytesMoved + image->m_Allocation.size > DEFRAG_MAX_BYTES_PER_STEP && !m_Moves.empty()) {
+			break;
+		}
+
+		Move move;
+		if (!PrepareImageMove(image, move)) {
+			break;
+		}
+		m_Moves.push_back(move);
+		bytesMoved += image->m_Allocation.size;
+	}
+
+	// Nothing could be moved, try again next frame
+	if (m_Moves.empty()) {
+		return;
+	}
+
+	// Record copies of every move into one submission
+	VkCommandBuffer commandBuffer = m_CommandPool->BeginSingleTimeCommands();
+	for (const Move& move : m_Moves) {
+		if (move.buffer != nullptr) {
+			RecordBufferCopy(commandBuffer, move);
+		}
+		else {
+			RecordImageCopy(commandBuffer, move);
+		}
+	}
+
+	// Make copied buffers visible to later frames
+	VkMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+	// Submit behind frames already queued, completion is polled in Update
+	m_Submission = m_CommandPool->Submit(commandBuffer);
+}
+
+// Create destination buffer in another block
+bool Defragmenter::PrepareBufferMove(Buffer* buffer, Move& move) {
+	// Buffer creation info
+	VkBufferCreateInfo bufferInfo = {};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = buffer->m_Size;
+	bufferInfo.usage = buffer->m_Usage;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	// Create destination buffer
+	VkBuffer newBuffer;
+	if (vkCreateBuffer(m_Device->GetDevice(), &bufferInfo, nullptr, &newBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create buffer!");
+	}
+
+	// Place it in another block of the same memory type
+	VkMemoryRequirements memRequirements;
+	vkGetBufferMemoryRequirements(m_Device->GetDevice(), newBuffer, &memRequirements);
+	Allocation allocation;
+	if (!m_Device->GetAllocator()->AllocateFromExistingBlocks(memRequirements, buffer->m_Allocation.memoryTypeIndex, buffer->m_Allocation.category, buffer->m_Allocation.block, allocation)) {
+		vkDestroyBuffer(m_Device->GetDevice(), newBuffer, nullptr);
+		return false;
+	}
+	vkBindBufferMemory(m_Device->GetDevice(), newBuffer, allocation.memory, allocation.offset);
+
+	// Fill in move
+	move.buffer = buffer;
+	move.newBuffer = newBuffer;
+	move.newAllocation = allocation;
+	return true;
+}
+
+// Create destination image in another block
+bool Defragmenter::PrepareImageMove(Image* image, Move& move) {
+	// Create destination image with the same parameters
+	VkImage newImage;
+	if (vkCreateImage(m_Device->GetDevice(), &image->m_ImageInfo, nullptr, &newImage) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create image!");
+	}
+
+	// Place it in another block of the same memory type
+	VkMemoryRequirements memRequirements;
+	vkGetImageMemoryRequirements(m_Device->GetDevice(), newImage, &memRequirements);
+	Allocation allocation;
+	if (!m_Device->GetAllocator()->AllocateFromExistingBlocks(memRequirements, image->m_Allocation.memoryTypeIndex, image->m_Allocation.category, image->m_Allocation.block, allocation)) {
+		vkDestroyImage(m_Device->GetDevice(), newImage, nullptr);
+		return false;
+	}
+	vkBindImageMemory(m_Device->GetDevice(), newImage, allocation.memory, allocation.offset);
+
+	// Fill in move
+	move.image = image;
+	move.newImage = newImage;
+	move.newImageView = image->CreateImageView(newImage);
+	move.newAllocation = allocation;
+	return true;
+}
+
+// Record copy of buffer contents
+void Defragmenter::RecordBufferCopy(VkCommandBuffer commandBuffer, const Move& move) {
+	VkBufferCopy copyRegion = {};
+	copyRegion.srcOffset = 0;
+	copyRegion.dstOffset = 0;
+	copyRegion.size = move.buffer->m_Size;
+	vkCmdCopyBuffer(commandBuffer, move.buffer->m_Buffer, move.newBuffer, 1, &copyRegion);
+}
+
+// Record copy of every mip level and layout transitions
+void Defragmenter::RecordImageCopy(VkCommandBuffer commandBuffer, const Move& move) {
+	Image* image = move.image;
+
+	// Barriers before copy: old image becomes source, new image becomes destination
+	VkImageMemoryBarrier barriers[2] = {};
+	for (VkImageMemoryBarrier& barrier : barriers) {
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.subresourceRange.aspectMask = image->m_AspectFlags;
+		barrier.subresourceRange.baseMipLevel = 0;
+		barrier.subresourceRange.levelCount = image->m_MipLevels;
+		barrier.subresourceRange.baseArrayLayer = 0;
+		barrier.subresourceRange.layerCount = 1;
+	}
+	barriers[0].image = image->m_Image;
+	barriers[0].oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barriers[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	barriers[0].srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	barriers[0].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	barriers[1].image = move.newImage;
+	barriers[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barriers[1].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barriers[1].srcAccessMask = 0;
+	barriers[1].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 2, barriers);
+
+	// Copy every mip level
+	std::vector<VkImageCopy> regions(image->m_MipLevels);
+	for (uint32_t i = 0; i < image->m_MipLevels; i++) {
+		regions[i] = {};
+		regions[i].srcSubresource.aspectMask = image->m_AspectFlags;
+		regions[i].srcSubresource.mipLevel = i;
+		regions[i].srcSubresource.baseArrayLayer = 0;
+		regions[i].srcSubresource.layerCount = 1;
+		regions[i].dstSubresource = regions[i].srcSubresource;
+		regions[i].extent.width = std::max(static_cast<uint32_t>(image->m_Width) >> i, 1u);
+		regions[i].extent.height = std::max(static_cast<uint32_t>(image->m_Height) >> i, 1u);
+		regions[i].extent.depth = 1;
+	}
+	vkCmdCopyImage(commandBuffer, image->m_Image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, move.newImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()), regions.data());
+
+	// Barriers after copy: both images return to shader reads
+	barriers[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	barriers[0].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barriers[0].srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	barriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	barriers[1].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barriers[1].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barriers[1].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barriers[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 2, barriers);
+}
+
+// Swap moved resources to their new memory
+void Defragmenter::CommitMoves() {
+	// Work submitted so far may still reference the old resources
+	QueueTimeline* timeline = m_Device->GetGraphicsTimeline();
+	uint64_t retireValue = timeline->GetLastSubmittedValue();
+	Device* device = m_Device;
+
+	for (Move& move : m_Moves) {
+		RetiredResource retired;
+
+		// Swap buffer
+		if (move.buffer != nullptr) {
+			retired.buffer = move.buffer->m_Buffer;
+			retired.allocation = move.buffer->m_Allocation;
+			move.buffer->m_Buffer = move.newBuffer;
+			move.buffer->m_Allocation = move.newAllocation;
+			m_MovedBuffers.push_back(move.buffer);
+		}
+
+		// Swap image and view
+		if (move.image != nullptr) {
+			retired.image = move.image->m_Image;
+			retired.imageView = move.image->m_ImageView;
+			retired.allocation = move.image->m_Allocation;
+			move.image->m_Image = move.newImage;
+			move.image->m_ImageView = move.newImageView;
+			move.image->m_Allocation = move.newAllocation;
+			m_MovedImages.push_back(move.image);
+		}
+
+		timeline->DestroyAfter(retireValue, [device, retired]() mutable { DestroyRetired(device, retired); });
+	}
+	m_Moves.clear();
+}
+
+// Destroy old resource and free its memory
+void Defragmenter::DestroyRetired(Device* device, RetiredResource& retired) {
+	if (retired.imageView != VK_NULL_HANDLE) {
+		vkDestroyImageView(device->GetDevice(), retired.imageView, nullptr);
+	}
+	if (retired.image != VK_NULL_HANDLE) {
+		vkDestroyImage(device->GetDevice(), retired.image, nullptr);
+	}
+	if (retired.buffer != VK_NULL_HANDLE) {
+		vkDestroyBuffer(device->GetDevice(), retired.buffer, nullptr);
+	}
+	device->GetAllocator()->Free(retired.allocation);
+}
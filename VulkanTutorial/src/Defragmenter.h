@@ -0,0 +1,69 @@
+#pragma once
+
+#include "vulkan/vulkan.h"
+
+#include <vector>
+
+#include "Buffer.h"
+#include "CommandPool.h"
+#include "Device.h"
+#include "Image.h"
+#include "MemoryAllocator.h"
+
+// Blocks used less than this fraction are drained by defragmentation
+const float DEFRAG_SPARSE_THRESHOLD = 0.5f;
+
+// Maximum bytes copied by one defragmentation step
+const VkDeviceSize DEFRAG_MAX_BYTES_PER_STEP = 16ull * 1024 * 1024;
+
+// Moves live buffers and images out of sparse memory blocks, a few each frame
+class Defragmenter {
+public:
+	Defragmenter(Device* device, CommandPool* commandPool);		// Constructor
+	~Defragmenter();											// Destructor
+
+	// FUNCTIONS
+	void Register(Buffer* buffer);		// Allow buffer to be moved
+	void Register(Image* image);		// Allow image to be moved
+	void Unregister(Buffer* buffer);	// Stop moving buffer (call before deleting it)
+	void Unregister(Image* image);		// Stop moving image (call before deleting it)
+	bool Update(std::vector<Buffer*>& movedBuffers, std::vector<Image*>& movedImages);	// Advance by one step, returns true and the moved resources if bindings need patching
+	bool Flush();						// Finish pending moves and destroy old resources, device must be idle
+private:
+	// STRUCTS
+	struct Move {
+		Buffer* buffer = nullptr;				// Buffer being moved
+		Image* image = nullptr;					// Image being moved
+		VkBuffer newBuffer = VK_NULL_HANDLE;	// Destination buffer
+		VkImage newImage = VK_NULL_HANDLE;		// Destination image
+		VkImageView newImageView = VK_NULL_HANDLE;	// Destination image view
+		Allocation newAllocation;				// Destination memory
+	};
+
+	struct RetiredResource {
+		VkBuffer buffer = VK_NULL_HANDLE;		// Old buffer
+		VkImage image = VK_NULL_HANDLE;			// Old image
+		VkImageView imageView = VK_NULL_HANDLE;	// Old image view
+		Allocation allocation;					// Old memory
+	};
+
+	// VARIABLES
+	Device* m_Device;						// Device object
+	CommandPool* m_CommandPool;				// Command pool for copy commands
+	std::vector<Buffer*> m_Buffers;			// Movable buffers
+	std::vector<Image*> m_Images;			// Movable images
+	std::vector<Move> m_Moves;				// Moves in flight on the GPU
+	SubmissionId m_Submission;				// Copy submission of moves in flight
+	std::vector<Buffer*> m_MovedBuffers;	// Buffers moved since last reported by Update
+	std::vector<Image*> m_MovedImages;		// Images moved since last reported by Update
+
+	// FUNCTIONS
+	MemoryBlock* FindSparseBlock();			// Find block worth draining
+	void BeginMoves(MemoryBlock* block);	// Record and submit copies out of block
+	bool PrepareBufferMove(Buffer* buffer, Move& move);		// Create destination buffer in another block
+	bool PrepareImageMove(Image* image, Move& move);		// Create destination image in another block
+	void RecordBufferCopy(VkCommandBuffer commandBuffer, const Move& move);	// Record copy of buffer contents
+	void RecordImageCopy(VkCommandBuffer commandBuffer, const Move& move);	// Record copy of every mip level and layout transitions
+	void CommitMoves();						// Swap moved resources to their new memory, old ones die once submitted work has finished
+	static void DestroyRetired(Device* device, RetiredResource& retired);	// Destroy old resource and free its memory
+};
@@ -0,0 +1,87 @@
+#include "DescriptorAllocator.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+// Constructor, pools are created on first allocation
+DescriptorAllocator::DescriptorAllocator(Device* device) : m_Device(device), m_NextPoolSets(DESCRIPTOR_POOL_INITIAL_SETS) {
+}
+
+// Destructor, destroys pools and their sets
+DescriptorAllocator::~DescriptorAllocator() {
+	for (VkDescriptorPool pool : m_UsedPools) {
+		vkDestroyDescriptorPool(m_Device->GetDevice(), pool, nullptr);
+	}
+	for (VkDescriptorPool pool : m_FreePools) {
+		vkDestroyDescriptorPool(m_Device->GetDevice(), pool, nullptr);
+	}
+}
+
+// Allocate set, adding a pool when the current one is exhausted
+VkDescriptorSet DescriptorAllocator::Allocate(VkDescriptorSetLayout layout) {
+	if (m_UsedPools.empty()) {
+		m_UsedPools.push_back(GetPool());
+	}
+
+	// Set allocation info
+	VkDescriptorSetAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = m_UsedPools.back();
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &layout;
+
+	VkDescriptorSet descriptorSet;
+	VkResult result = vkAllocateDescriptorSets(m_Device->GetDevice(), &allocInfo, &descriptorSet);
+
+	// Out of sets or descriptors, continue in another pool
+	if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) {
+		m_UsedPools.push_back(GetPool());
+		allocInfo.descriptorPool = m_UsedPools.back();
+		result = vkAllocateDescriptorSets(m_Device->GetDevice(), &allocInfo, &descriptorSet);
+	}
+
+	if (result != VK_SUCCESS) {
+		throw std::runtime_error("Failed to allocate descriptor sets!");
+	}
+	return descriptorSet;
+}
+
+// Free every set, none may be used by pending work
+void DescriptorAllocator::Reset() {
+	for (VkDescriptorPool pool : m_UsedPools) {
+		vkResetDescriptorPool(m_Device->GetDevice(), pool, 0);
+		m_FreePools.push_back(pool);
+	}
+	m_UsedPools.clear();
+}
+
+// Reset pool to reuse or a new larger one
+VkDescriptorPool DescriptorAllocator::GetPool() {
+	if (!m_FreePools.empty()) {
+		VkDescriptorPool pool = m_FreePools.back();
+		m_FreePools.pop_back();
+		return pool;
+	}
+
+	// Pool size description
+	std::vector<VkDescriptorPoolSize> poolSizes;
+	for (const auto& ratio : DESCRIPTOR_POOL_RATIOS) {
+		poolSizes.push_back({ ratio.first, std::max(1u, static_cast<uint32_t>(ratio.second * m_NextPoolSets)) });
+	}
+
+	// Descriptor pool creation info
+	VkDescriptorPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+	poolInfo.maxSets = m_NextPoolSets;
+
+	// Create descriptor pool
+	VkDescriptorPool pool;
+	if (vkCreateDescriptorPool(m_Device->GetDevice(), &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create descriptor pool!");
+	}
+
+	m_NextPoolSets = std::min(m_NextPoolSets * 2, DESCRIPTOR_POOL_MAX_SETS);
+	return pool;
+}
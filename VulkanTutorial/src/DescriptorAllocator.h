@@ -0,0 +1,44 @@
+#pragma once
+
+#include "vulkan/vulkan.h"
+#include "Device.h"
+
+#include <utility>
+#include <vector>
+
+// Sets in the first pool, each new pool doubles up to the maximum
+const uint32_t DESCRIPTOR_POOL_INITIAL_SETS = 64;
+const uint32_t DESCRIPTOR_POOL_MAX_SETS = 4096;
+
+// Descriptors of each type reserved per set in a pool
+const std::vector<std::pair<VkDescriptorType, float>> DESCRIPTOR_POOL_RATIOS = {
+	{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2.0f },
+	{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4.0f },
+	{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1.0f },
+	{ VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1.0f },
+	{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.0f },
+	{ VK_DESCRIPTOR_TYPE_SAMPLER, 0.5f }
+};
+
+// Descriptor sets from a chain of growing pools, reset all at once
+class DescriptorAllocator {
+public:
+	DescriptorAllocator(Device* device);	// Constructor, pools are created on first allocation
+	~DescriptorAllocator();					// Destructor, destroys pools and their sets
+
+	// FUNCTIONS
+	VkDescriptorSet Allocate(VkDescriptorSetLayout layout);	// Allocate set, adding a pool when the current one is exhausted
+	void Reset();							// Free every set, none may be used by pending work
+
+	// GETTERS
+	size_t GetPoolCount() { return m_UsedPools.size() + m_FreePools.size(); }
+private:
+	// VARIABLES
+	Device* m_Device;						// Vulkan device
+	std::vector<VkDescriptorPool> m_UsedPools;	// Pools sets were allocated from, last one is current
+	std::vector<VkDescriptorPool> m_FreePools;	// Reset pools to reuse
+	uint32_t m_NextPoolSets;				// Sets of next created pool
+
+	// FUNCTIONS
+	VkDescriptorPool GetPool();				// Reset pool to reuse or a new larger one
+};
@@ -0,0 +1,80 @@
+#include "DescriptorCache.h"
+
+#include <iostream>
+
+// Constructor
+DescriptorCache::DescriptorCache(Device* device) : m_Device(device), m_Allocator(device), m_Hits(0), m_Misses(0) {
+}
+
+// Destructor, frees every set
+DescriptorCache::~DescriptorCache() {
+}
+
+// Cached set with contents, allocated and written on first use
+VkDescriptorSet DescriptorCache::GetDescriptorSet(VkDescriptorSetLayout layout, const std::vector<DescriptorWrite>& writes) {
+	// Layout, then every write's binding and the handles it points at
+	std::vector<uint64_t> key = { (uint64_t)layout };
+	for (const DescriptorWrite& write : writes) {
+		key.push_back((static_cast<uint64_t>(write.binding) << 32) | static_cast<uint32_t>(write.type));
+		if (IsBufferDescriptor(write.type)) {
+			key.insert(key.end(), { (uint64_t)write.bufferInfo.buffer, write.bufferInfo.offset, write.bufferInfo.range });
+		}
+		else {
+			key.insert(key.end(), { (uint64_t)write.imageInfo.sampler, (uint64_t)write.imageInfo.imageView, static_cast<uint64_t>(write.imageInfo.imageLayout) });
+		}
+	}
+
+	auto found = m_Sets.find(key);
+	if (found != m_Sets.end()) {
+		m_Hits++;
+		return found->second;
+	}
+	m_Misses++;
+
+	// Allocate and write new set
+	VkDescriptorSet descriptorSet = m_Allocator.Allocate(layout);
+	std::vector<VkWriteDescriptorSet> descriptorWrites(writes.size());
+	for (size_t i = 0; i < writes.size(); i++) {
+		descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[i].dstSet = descriptorSet;
+		descriptorWrites[i].dstBinding = writes[i].binding;
+		descriptorWrites[i].dstArrayElement = 0;
+		descriptorWrites[i].descriptorType = writes[i].type;
+		descriptorWrites[i].descriptorCount = 1;
+		if (IsBufferDescriptor(writes[i].type)) {
+			descriptorWrites[i].pBufferInfo = &writes[i].bufferInfo;
+		}
+		else {
+			descriptorWrites[i].pImageInfo = &writes[i].imageInfo;
+		}
+	}
+	vkUpdateDescriptorSets(m_Device->GetDevice(), static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+
+	m_Sets[key] = descriptorSet;
+	return descriptorSet;
+}
+
+// Forget and free every set, none may be used by pending work
+void DescriptorCache::Reset() {
+	m_Sets.clear();
+	m_Allocator.Reset();
+}
+
+// Print reused and written sets
+void DescriptorCache::LogStats() {
+	std::cout << "Descriptor sets: " << m_Hits << " reused, " << m_Misses << " written, "
+		<< m_Sets.size() << " cached in " << m_Allocator.GetPoolCount() << " pools" << std::endl;
+}
+
+// True if type is described by a buffer info
+bool DescriptorCache::IsBufferDescriptor(VkDescriptorType type) {
+	switch (type) {
+	case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+	case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+	case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+	case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC:
+		return true;
+	default:
+		return false;
+	}
+}
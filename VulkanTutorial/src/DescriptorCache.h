@@ -0,0 +1,42 @@
+#pragma once
+
+#include "vulkan/vulkan.h"
+#include "Device.h"
+
+#include <map>
+#include <vector>
+
+#include "DescriptorAllocator.h"
+
+// Resource written to one binding of a cached set
+struct DescriptorWrite {
+	uint32_t binding;						// Binding in set
+	VkDescriptorType type;					// Descriptor type
+	VkDescriptorBufferInfo bufferInfo;		// Buffer of buffer descriptors
+	VkDescriptorImageInfo imageInfo;		// Image and sampler of image descriptors
+};
+
+// Descriptor sets by layout and contents, reset or replace before a cached handle is reused
+class DescriptorCache {
+public:
+	DescriptorCache(Device* device);		// Constructor
+	~DescriptorCache();						// Destructor, frees every set
+
+	// FUNCTIONS
+	VkDescriptorSet GetDescriptorSet(VkDescriptorSetLayout layout, const std::vector<DescriptorWrite>& writes);	// Cached set with contents, allocated and written on first use
+	void Reset();							// Forget and free every set, none may be used by pending work
+	void LogStats();						// Print reused and written sets
+
+	// GETTERS
+	size_t GetSetCount() { return m_Sets.size(); }
+private:
+	// VARIABLES
+	Device* m_Device;						// Vulkan device
+	DescriptorAllocator m_Allocator;		// Pools of cached sets
+	std::map<std::vector<uint64_t>, VkDescriptorSet> m_Sets;	// Sets by layout and contents
+	uint64_t m_Hits;						// Requests served by an existing set
+	uint64_t m_Misses;						// Requests that wrote a new set
+
+	// FUNCTIONS
+	static bool IsBufferDescriptor(VkDescriptorType type);	// True if type is described by a buffer info
+};
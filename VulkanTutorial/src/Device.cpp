@@ -2,18 +2,31 @@
 
 #include <stdexcept>
 #include <map>
-#include <set>
-#include <string>
 #include <algorithm>
+#include <cstring>
 
 // Constructor
-Device::Device(VkInstance instance, VkSurfaceKHR surface) : m_Surface(surface) {
+Device::Device(VkInstance instance, VkSurfaceKHR surface) : m_Instance(instance), m_Surface(surface) {
 	PickPhysicalDevice(instance);
 	CreateLogicalDevice();
+	m_Allocator = new MemoryAllocator(this);
+	m_GraphicsTimeline = new QueueTimeline(this, m_GraphicsQueue);
+
+	// Compute shares the graphics timeline when it has no queue of its own
+	m_ComputeTimeline = HasAsyncCompute() ? new QueueTimeline(this, m_ComputeQueue) : m_GraphicsTimeline;
 }
 
 // Destructor
 Device::~Device() {
+	// Delete timelines, waiting for the queues and running deferred destruction
+	if (m_ComputeTimeline != m_GraphicsTimeline) {
+		delete(m_ComputeTimeline);
+	}
+	delete(m_GraphicsTimeline);
+
+	// Delete memory allocator
+	delete(m_Allocator);
+
 	// Destroy device
 	vkDestroyDevice(m_Device, nullptr);
 }
@@ -23,18 +36,23 @@ void Device::CreateLogicalDevice() {
 
 	// Get queue data from physical device
 	QueueFamilyIndices indices = FindQueueFamilies(m_PhysicalDevice);
+	m_QueueFamilies = indices;
+
+	// Queues needed from each family, compute may take a second graphics queue
+	std::map<uint32_t, uint32_t> queueCounts = { { indices.graphicsFamily.value(), 1 } };
+	queueCounts[indices.presentFamily.value()] = std::max(queueCounts[indices.presentFamily.value()], 1u);
+	queueCounts[indices.computeFamily.value()] = std::max(queueCounts[indices.computeFamily.value()], indices.computeQueueIndex + 1);
 
 	// Create device queues
 	std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-	std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value(), indices.presentFamily.value() };
-	float queuePriority = 1.0f;
-	for (uint32_t queueFamily : uniqueQueueFamilies) {
+	std::vector<float> queuePriorities = { 1.0f, 1.0f };
+	for (const auto& queueCount : queueCounts) {
 		// Create device queue
 		VkDeviceQueueCreateInfo queueCreateInfo = {};
 		queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-		queueCreateInfo.queueFamilyIndex = queueFamily;
-		queueCreateInfo.queueCount = 1;
-		queueCreateInfo.pQueuePriorities = &queuePriority;
+		queueCreateInfo.queueFamilyIndex = queueCount.first;
+		queueCreateInfo.queueCount = queueCount.second;
+		queueCreateInfo.pQueuePriorities = queuePriorities.data();
 		queueCreateInfos.push_back(queueCreateInfo);
 	}
 
@@ -42,14 +60,67 @@ void Device::CreateLogicalDevice() {
 	VkPhysicalDeviceFeatures deviceFeatures = {};
 	deviceFeatures.samplerAnisotropy = VK_TRUE;
 
+	// Enable required extensions and whichever optional ones are supported, headless needs no swap chain
+	if (!IsHeadless()) {
+		m_EnabledExtensions = deviceExtensions;
+	}
+	std::set<std::string> availableExtensions = GetAvailableExtensions(m_PhysicalDevice);
+	for (const char* extension : optionalDeviceExtensions) {
+		if (availableExtensions.count(extension) == 0) {
+			continue;
+		}
+
+		// Memory budget is queried through an instance extension
+		if (strcmp(extension, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0 && !CheckInstanceExtensionSupport(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME)) {
+			continue;
+		}
+
+#ifdef VK_KHR_timeline_semaphore
+		// Timeline semaphore extension is useless unless the feature is supported
+		if (strcmp(extension, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME) == 0 && !CheckTimelineSemaphoreSupport()) {
+			continue;
+		}
+#endif
+
+		// Descriptor indexing depends on maintenance3 and is useless without its bindless features
+		if (strcmp(extension, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME) == 0 && (availableExtensions.count(VK_KHR_MAINTENANCE3_EXTENSION_NAME) == 0 || !CheckDescriptorIndexingSupport())) {
+			continue;
+		}
+
+		m_EnabledExtensions.push_back(extension);
+	}
+
 	// Logical device creation info
 	VkDeviceCreateInfo createInfo = {};
 	createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 	createInfo.pQueueCreateInfos = queueCreateInfos.data();
 	createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
 	createInfo.pEnabledFeatures = &deviceFeatures;
-	createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-	createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+	createInfo.enabledExtensionCount = static_cast<uint32_t>(m_EnabledExtensions.size());
+	createInfo.ppEnabledExtensionNames = m_EnabledExtensions.data();
+
+#ifdef VK_KHR_timeline_semaphore
+	// Enable timeline semaphores with their extension
+	VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineFeatures = {};
+	timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+	timelineFeatures.timelineSemaphore = VK_TRUE;
+	if (IsExtensionEnabled(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME)) {
+		createInfo.pNext = &timelineFeatures;
+	}
+#endif
+
+	// Enable descriptor indexing features used by bindless textures
+	VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures = {};
+	indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+	indexingFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+	indexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+	indexingFeatures.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+	indexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+	indexingFeatures.runtimeDescriptorArray = VK_TRUE;
+	if (IsBindlessSupported()) {
+		indexingFeatures.pNext = const_cast<void*>(createInfo.pNext);
+		createInfo.pNext = &indexingFeatures;
+	}
 	if (enableValidationLayers) {
 		createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
 		createInfo.ppEnabledLayerNames = validationLayers.data();
@@ -66,6 +137,7 @@ void Device::CreateLogicalDevice() {
 	// Get queue and store in m_GraphicsQueue
 	vkGetDeviceQueue(m_Device, indices.graphicsFamily.value(), 0, &m_GraphicsQueue);
 	vkGetDeviceQueue(m_Device, indices.presentFamily.value(), 0, &m_PresentQueue);
+	vkGetDeviceQueue(m_Device, indices.computeFamily.value(), indices.computeQueueIndex, &m_ComputeQueue);
 }
 
 // Select physical device for Vulkan to use
@@ -144,9 +216,11 @@ int Device::RateDeviceSuitable(VkPhysicalDevice device) {
 	}
 
 	// Check swap chain support
-	SwapChainSupportDetails swapChainSupport = QuerySwapChainSupport(device);
-	if (swapChainSupport.formats.empty() || swapChainSupport.presentModes.empty()) {
-		return 0;
+	if (!IsHeadless()) {
+		SwapChainSupportDetails swapChainSupport = QuerySwapChainSupport(device);
+		if (swapChainSupport.formats.empty() || swapChainSupport.presentModes.empty()) {
+			return 0;
+		}
 	}
 
 	// Return score
@@ -163,48 +237,156 @@ QueueFamilyIndices Device::FindQueueFamilies(VkPhysicalDevice device) {
 	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
 	vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
 
-	// Check if queue that supports graphics bit exists
-	int i = 0;
+	uint32_t i = 0;
 	for (const auto& queueFamily : queueFamilies) {
-		if (queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
-			indices.graphicsFamily = i;
-		}
-
-		// Check if queue supports presenting to window surface
-		VkBool32 presentSupport = false;
-		vkGetPhysicalDeviceSurfaceSupportKHR(device, i, m_Surface, &presentSupport);
-		if (queueFamily.queueCount > 0 && presentSupport) {
-			indices.presentFamily = i;
+		// Keep graphics and present families once both are found
+		if (!indices.IsComplete()) {
+			// Check if queue that supports graphics bit exists
+			if (queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+				indices.graphicsFamily = i;
+			}
+
+			// Check if queue supports presenting to window surface, headless uses the graphics queue
+			VkBool32 presentSupport = false;
+			if (IsHeadless()) {
+				presentSupport = (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) ? VK_TRUE : VK_FALSE;
+			}
+			else {
+				vkGetPhysicalDeviceSurfaceSupportKHR(device, i, m_Surface, &presentSupport);
+			}
+			if (queueFamily.queueCount > 0 && presentSupport) {
+				indices.presentFamily = i;
+			}
 		}
 
-		// Break if queue is found
-		if (indices.IsComplete()) {
-			break;
+		// Prefer a compute family without graphics, it runs asynchronously to rendering
+		if (!indices.computeFamily.has_value() && queueFamily.queueCount > 0 && (queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT) && !(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)) {
+			indices.computeFamily = i;
 		}
 
 		i++;
 	}
 
+	// Otherwise use a second graphics queue if there is one, else the graphics queue itself
+	if (!indices.computeFamily.has_value() && indices.graphicsFamily.has_value()) {
+		indices.computeFamily = indices.graphicsFamily;
+		indices.computeQueueIndex = queueFamilies[indices.graphicsFamily.value()].queueCount > 1 ? 1 : 0;
+	}
 
 	// Return
 	return indices;
 }
 
-// Returns true if extensions are supported
-bool Device::CheckDeviceExtensionSupport(VkPhysicalDevice device) {
+// True if device extension was enabled
+bool Device::IsExtensionEnabled(const char* extension) {
+	for (const char* enabledExtension : m_EnabledExtensions) {
+		if (strcmp(enabledExtension, extension) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
 
+// True if instance extension is supported
+bool Device::CheckInstanceExtensionSupport(const char* extension) {
+	// Query instance extensions
+	uint32_t extensionCount;
+	vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
+	std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+	vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, availableExtensions.data());
+
+	// Look for extension
+	for (const auto& availableExtension : availableExtensions) {
+		if (strcmp(availableExtension.extensionName, extension) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// Names of extensions supported by device
+std::set<std::string> Device::GetAvailableExtensions(VkPhysicalDevice device) {
 	// Query extensions
 	uint32_t extensionCount;
 	vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
 	std::vector<VkExtensionProperties> availableExtensions(extensionCount);
 	vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
 
-	// Required extensions
-	std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
+	// Collect names
+	std::set<std::string> names;
+	for (const auto& extension : availableExtensions) {
+		names.insert(extension.extensionName);
+	}
+	return names;
+}
+
+// True if physical device supports timeline semaphores
+bool Device::CheckTimelineSemaphoreSupport() {
+#ifdef VK_KHR_timeline_semaphore
+	// Features are queried through an instance extension
+	if (!CheckInstanceExtensionSupport(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME)) {
+		return false;
+	}
+	auto getFeatures2 = (PFN_vkGetPhysicalDeviceFeatures2KHR)vkGetInstanceProcAddr(m_Instance, "vkGetPhysicalDeviceFeatures2KHR");
+	if (getFeatures2 == nullptr) {
+		return false;
+	}
+
+	// Query timeline semaphore feature
+	VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineFeatures = {};
+	timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+	VkPhysicalDeviceFeatures2KHR features = {};
+	features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	features.pNext = &timelineFeatures;
+	getFeatures2(m_PhysicalDevice, &features);
+
+	return timelineFeatures.timelineSemaphore == VK_TRUE;
+#else
+	return false;
+#endif
+}
+
+// True if physical device supports the descriptor indexing features of bindless textures
+bool Device::CheckDescriptorIndexingSupport() {
+	// Features are queried through an instance extension
+	if (!CheckInstanceExtensionSupport(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME)) {
+		return false;
+	}
+	auto getFeatures2 = (PFN_vkGetPhysicalDeviceFeatures2KHR)vkGetInstanceProcAddr(m_Instance, "vkGetPhysicalDeviceFeatures2KHR");
+	if (getFeatures2 == nullptr) {
+		return false;
+	}
+
+	// Query descriptor indexing features
+	VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures = {};
+	indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+	VkPhysicalDeviceFeatures2KHR features = {};
+	features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	features.pNext = &indexingFeatures;
+	getFeatures2(m_PhysicalDevice, &features);
+
+	return indexingFeatures.shaderSampledImageArrayNonUniformIndexing == VK_TRUE
+		&& indexingFeatures.descriptorBindingSampledImageUpdateAfterBind == VK_TRUE
+		&& indexingFeatures.descriptorBindingUpdateUnusedWhilePending == VK_TRUE
+		&& indexingFeatures.descriptorBindingPartiallyBound == VK_TRUE
+		&& indexingFeatures.runtimeDescriptorArray == VK_TRUE;
+}
+
+// Returns true if extensions are supported
+bool Device::CheckDeviceExtensionSupport(VkPhysicalDevice device) {
+
+	// Query extensions
+	std::set<std::string> availableExtensions = GetAvailableExtensions(device);
+
+	// Required extensions, headless rendering needs none
+	std::set<std::string> requiredExtensions;
+	if (!IsHeadless()) {
+		requiredExtensions.insert(deviceExtensions.begin(), deviceExtensions.end());
+	}
 
 	// Loop through extensions
 	for (const auto& extension : availableExtensions) {
-		requiredExtensions.erase(extension.extensionName);
+		requiredExtensions.erase(extension);
 	}
 
 	// return true if all required extensions were found
@@ -1,8 +1,12 @@
 #pragma once
 
 #include "vulkan/vulkan.h"
+#include "MemoryAllocator.h"
+#include "QueueTimeline.h"
 
 #include <optional>
+#include <set>
+#include <string>
 #include <vector>
 
 // Define if validation is enabled
@@ -17,6 +21,12 @@ const std::vector<const char*> validationLayers = {
 	"VK_LAYER_KHRONOS_validation"
 };
 
+// Queues work can be submitted to
+typedef enum QueueType {
+	QUEUE_TYPE_GRAPHICS,
+	QUEUE_TYPE_COMPUTE
+} QueueType;
+
 // STRUCTS
 struct SwapChainSupportDetails {
 	VkSurfaceCapabilitiesKHR capabilities;
@@ -27,6 +37,8 @@ struct SwapChainSupportDetails {
 struct QueueFamilyIndices {
 	std::optional<uint32_t> graphicsFamily;
 	std::optional<uint32_t> presentFamily;
+	std::optional<uint32_t> computeFamily;
+	uint32_t computeQueueIndex = 0;		// Queue of compute family, 1 when it is a second graphics queue
 
 	bool IsComplete() {
 		return graphicsFamily.has_value() && presentFamily.has_value();
@@ -38,35 +50,72 @@ const std::vector<const char*> deviceExtensions = {
 	VK_KHR_SWAPCHAIN_EXTENSION_NAME
 };
 
+// Device extensions to use when supported
+const std::vector<const char*> optionalDeviceExtensions = {
+	VK_EXT_MEMORY_BUDGET_EXTENSION_NAME,
+#ifdef VK_KHR_timeline_semaphore
+	VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME,
+#endif
+	VK_KHR_MAINTENANCE3_EXTENSION_NAME,
+	VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME
+};
+
+// Instance extensions to use when supported
+const std::vector<const char*> optionalInstanceExtensions = {
+	VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME
+};
+
 class Device {
 public:
-	Device(VkInstance instance, VkSurfaceKHR surface);		// Constructor
+	Device(VkInstance instance, VkSurfaceKHR surface);		// Constructor, null surface renders headless without presenting
 	~Device();		// Destructor
 
 	// FUNCTIONS
 	SwapChainSupportDetails QuerySwapChainSupport(VkPhysicalDevice device);	// Query swap chains
 	QueueFamilyIndices FindQueueFamilies(VkPhysicalDevice device);			// Return queue indices available on device
+	bool IsExtensionEnabled(const char* extension);							// True if device extension was enabled
+	static bool CheckInstanceExtensionSupport(const char* extension);		// True if instance extension is supported
 
 	// GETTERS
+	VkInstance GetInstance() { return m_Instance; }
 	VkPhysicalDevice GetPhysicalDevice() { return m_PhysicalDevice; }
 	VkDevice GetDevice() { return m_Device; }
 	VkQueue GetGraphicsQueue() { return m_GraphicsQueue; }
 	VkQueue GetPresentQueue() { return m_PresentQueue; }
+	VkQueue GetComputeQueue() { return m_ComputeQueue; }
+	uint32_t GetQueueFamily(QueueType type) { return type == QUEUE_TYPE_COMPUTE ? m_QueueFamilies.computeFamily.value() : m_QueueFamilies.graphicsFamily.value(); }
+	bool IsHeadless() { return m_Surface == VK_NULL_HANDLE; }	// True if device never presents
+	bool HasAsyncCompute() { return m_ComputeQueue != m_GraphicsQueue; }	// True if compute work can overlap graphics work
+	bool IsBindlessSupported() { return IsExtensionEnabled(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME); }	// True if partially bound, update after bind texture arrays can be used
 	VkSampleCountFlagBits GetSamples() { return m_MsaaSamples; }
+	MemoryAllocator* GetAllocator() { return m_Allocator; }
+	QueueTimeline* GetGraphicsTimeline() { return m_GraphicsTimeline; }
+	QueueTimeline* GetComputeTimeline() { return m_ComputeTimeline; }	// Graphics timeline without async compute
+	QueueTimeline* GetTimeline(QueueType type) { return type == QUEUE_TYPE_COMPUTE ? m_ComputeTimeline : m_GraphicsTimeline; }
 private:
 	// VARIABLES
+	VkInstance m_Instance;					// Vulkan instance
 	VkPhysicalDevice m_PhysicalDevice;		// Vulkan physical device
 	VkDevice m_Device;						// Vulkan logical device
 	VkQueue m_GraphicsQueue;				// Vulkan graphics queue
 	VkQueue m_PresentQueue;					// Vulkan present queue
+	VkQueue m_ComputeQueue;					// Vulkan compute queue, graphics queue if no other exists
+	QueueFamilyIndices m_QueueFamilies;		// Queue families and compute queue index used
 	VkSurfaceKHR m_Surface;					// Vulkan surface
 	VkSampleCountFlagBits m_MsaaSamples = VK_SAMPLE_COUNT_1_BIT;	// MSAA samples
+	MemoryAllocator* m_Allocator;			// Device memory allocator
+	QueueTimeline* m_GraphicsTimeline;		// Completion of graphics queue submissions
+	QueueTimeline* m_ComputeTimeline;		// Completion of compute queue submissions
+	std::vector<const char*> m_EnabledExtensions;	// Required and supported optional device extensions
 
 	// FUNCTIONS
 	void CreateLogicalDevice();						// Create Vulkan logical devic
 	void PickPhysicalDevice(VkInstance instance);	// Select physical device for Vulkan to use
 	int RateDeviceSuitable(VkPhysicalDevice device);						// Return suitability score of device
 	bool CheckDeviceExtensionSupport(VkPhysicalDevice device);				// Returns true if extensions are supported
+	std::set<std::string> GetAvailableExtensions(VkPhysicalDevice device);	// Names of extensions supported by device
+	bool CheckTimelineSemaphoreSupport();	// True if physical device supports timeline semaphores
+	bool CheckDescriptorIndexingSupport();	// True if physical device supports the descriptor indexing features of bindless textures
 	VkSampleCountFlagBits GetMaxUsableSampleCount();	// Max MSAA samples amount
 
 };
\ No newline at end of file
@@ -0,0 +1,122 @@
+#include "DynamicResolution.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+// Constructor
+DynamicResolution::DynamicResolution(Device* device, uint32_t framesInFlight, double targetFrameRate)
+	: m_Device(device), m_QueryPool(VK_NULL_HANDLE), m_TimestampPeriod(1.0), m_TimestampMask(0), m_FrameRecorded(framesInFlight, false),
+	m_TargetFrameTime(1.0 / targetFrameRate), m_GpuTime(0.0), m_Scale(1.0f) {
+	// Timestamps of graphics queue
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(m_Device->GetPhysicalDevice(), &queueFamilyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(m_Device->GetPhysicalDevice(), &queueFamilyCount, queueFamilies.data());
+	uint32_t validBits = queueFamilies[m_Device->GetQueueFamily(QUEUE_TYPE_GRAPHICS)].timestampValidBits;
+	if (validBits == 0) {
+		std::cout << "Dynamic resolution disabled, graphics queue has no timestamps" << std::endl;
+		return;
+	}
+	m_TimestampMask = validBits >= 64 ? UINT64_MAX : ((1ull << validBits) - 1);
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(m_Device->GetPhysicalDevice(), &properties);
+	m_TimestampPeriod = properties.limits.timestampPeriod;
+
+	// Query pool creation info
+	VkQueryPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	poolInfo.queryCount = framesInFlight * 2;
+
+	// Create query pool
+	if (vkCreateQueryPool(m_Device->GetDevice(), &poolInfo, nullptr, &m_QueryPool) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create timestamp query pool!");
+	}
+}
+
+// Destructor
+DynamicResolution::~DynamicResolution() {
+	if (m_QueryPool != VK_NULL_HANDLE) {
+		vkDestroyQueryPool(m_Device->GetDevice(), m_QueryPool, nullptr);
+	}
+}
+
+// Reset frame's queries and record start timestamp
+void DynamicResolution::BeginFrame(VkCommandBuffer commandBuffer, uint32_t frame) {
+	if (m_QueryPool == VK_NULL_HANDLE) {
+		return;
+	}
+
+	vkCmdResetQueryPool(commandBuffer, m_QueryPool, frame * 2, 2);
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_QueryPool, frame * 2);
+}
+
+// Record end timestamp
+void DynamicResolution::EndFrame(VkCommandBuffer commandBuffer, uint32_t frame) {
+	if (m_QueryPool == VK_NULL_HANDLE) {
+		return;
+	}
+
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_QueryPool, frame * 2 + 1);
+	m_FrameRecorded[frame] = true;
+}
+
+// Read GPU time of finished frame and adjust scale, true if scale changed
+bool DynamicResolution::Update(uint32_t frame) {
+	if (m_QueryPool == VK_NULL_HANDLE || !m_FrameRecorded[frame]) {
+		return false;
+	}
+
+	// Frame has finished, so its timestamps are available
+	uint64_t timestamps[2] = {};
+	if (vkGetQueryPoolResults(m_Device->GetDevice(), m_QueryPool, frame * 2, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) {
+		return false;
+	}
+	m_FrameRecorded[frame] = false;
+	double gpuTime = static_cast<double>((timestamps[1] - timestamps[0]) & m_TimestampMask) * m_TimestampPeriod * 1e-9;
+	m_GpuTime = (m_GpuTime == 0.0) ? gpuTime : m_GpuTime + DYNAMIC_RESOLUTION_SMOOTHING * (gpuTime - m_GpuTime);
+
+	// Scale that would hit the target if cost follows pixel count
+	float scale = m_Scale;
+	float idealScale = m_Scale * static_cast<float>(std::sqrt(m_TargetFrameTime / std::max(m_GpuTime, 1e-6)));
+	if (m_GpuTime > m_TargetFrameTime) {
+		// Over budget, drop straight to the step below the ideal scale
+		scale = std::floor(idealScale / DYNAMIC_RESOLUTION_STEP + 0.001f) * DYNAMIC_RESOLUTION_STEP;
+	}
+	else if (m_GpuTime < m_TargetFrameTime * DYNAMIC_RESOLUTION_HEADROOM) {
+		// Under budget, grow one step at a time so overshoot stays small
+		scale = std::min(m_Scale + DYNAMIC_RESOLUTION_STEP, idealScale);
+		scale = std::floor(scale / DYNAMIC_RESOLUTION_STEP + 0.001f) * DYNAMIC_RESOLUTION_STEP;
+	}
+	scale = std::max(DYNAMIC_RESOLUTION_MIN_SCALE, std::min(scale, 1.0f));
+	if (std::fabs(scale - m_Scale) < DYNAMIC_RESOLUTION_STEP * 0.5f) {
+		return false;
+	}
+
+	// Predict GPU time at new scale until samples catch up
+	m_GpuTime *= (scale * scale) / (m_Scale * m_Scale);
+	m_Scale = scale;
+	return true;
+}
+
+// Output extent reduced by scale
+VkExtent2D DynamicResolution::GetRenderExtent(VkExtent2D outputExtent) {
+	VkExtent2D extent;
+	extent.width = std::max(static_cast<uint32_t>(outputExtent.width * m_Scale + 0.5f), 1u);
+	extent.height = std::max(static_cast<uint32_t>(outputExtent.height * m_Scale + 0.5f), 1u);
+	return extent;
+}
+
+// Print scale and GPU time
+void DynamicResolution::LogStats() {
+	if (m_QueryPool == VK_NULL_HANDLE) {
+		return;
+	}
+
+	std::cout << std::fixed << std::setprecision(2) << "Resolution scale " << m_Scale << ", GPU " << m_GpuTime * 1000.0 << " ms, target "
+		<< m_TargetFrameTime * 1000.0 << " ms" << std::defaultfloat << std::endl;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "vulkan/vulkan.h"
+#include "Device.h"
+
+#include <cstdint>
+#include <vector>
+
+// Lowest fraction of the output resolution rendered
+const float DYNAMIC_RESOLUTION_MIN_SCALE = 0.5f;
+
+// Scale changes in steps, so static bundles are re-recorded only when a step is crossed
+const float DYNAMIC_RESOLUTION_STEP = 0.05f;
+
+// Scale grows only while GPU time is below this fraction of the target
+const double DYNAMIC_RESOLUTION_HEADROOM = 0.85;
+
+// Weight of the newest GPU time sample
+const double DYNAMIC_RESOLUTION_SMOOTHING = 0.1;
+
+// Chooses the scene resolution from GPU frame times
+class DynamicResolution {
+public:
+	DynamicResolution(Device* device, uint32_t framesInFlight, double targetFrameRate);	// Constructor
+	~DynamicResolution();												// Destructor
+
+	// FUNCTIONS
+	void BeginFrame(VkCommandBuffer commandBuffer, uint32_t frame);	// Reset frame's queries and record start timestamp
+	void EndFrame(VkCommandBuffer commandBuffer, uint32_t frame);	// Record end timestamp
+	bool Update(uint32_t frame);			// Read GPU time of finished frame and adjust scale, true if scale changed
+	VkExtent2D GetRenderExtent(VkExtent2D outputExtent);	// Output extent reduced by scale
+	void LogStats();						// Print scale and GPU time
+
+	// GETTERS
+	float GetScale() { return m_Scale; }
+	bool IsSupported() { return m_QueryPool != VK_NULL_HANDLE; }	// False if queue has no timestamps, scale stays 1
+private:
+	// VARIABLES
+	Device* m_Device;						// Device object
+	VkQueryPool m_QueryPool;				// Start and end timestamp per frame in flight
+	double m_TimestampPeriod;				// Nanoseconds per timestamp tick
+	uint64_t m_TimestampMask;				// Valid bits of timestamps
+	std::vector<bool> m_FrameRecorded;		// Frames in flight whose timestamps were recorded
+	double m_TargetFrameTime;				// Seconds of GPU time per frame to hold
+	double m_GpuTime;						// Smoothed seconds of GPU time per frame, 0 before first sample
+	float m_Scale;							// Fraction of output resolution rendered
+};
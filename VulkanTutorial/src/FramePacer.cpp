@@ -0,0 +1,137 @@
+#include "FramePacer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#pragma comment(lib, "winmm.lib")
+#endif
+
+// Constructor, 0 leaves frame rate unlimited
+FramePacer::FramePacer(double targetFrameRate)
+	: m_Period(0.0), m_Started(false), m_WorkEstimate(0.0), m_SpinThreshold(PACER_MIN_SPIN_SECONDS),
+	m_FrameCount(0), m_FrameTimeMean(0.0), m_FrameTimeM2(0.0), m_FrameTimeMin(0.0), m_FrameTimeMax(0.0) {
+	SetTargetFrameRate(targetFrameRate);
+
+#ifdef _WIN32
+	// Default scheduler granularity is too coarse to sleep within a frame
+	timeBeginPeriod(1);
+#endif
+}
+
+// Destructor
+FramePacer::~FramePacer() {
+#ifdef _WIN32
+	timeEndPeriod(1);
+#endif
+}
+
+// Change target, 0 leaves frame rate unlimited
+void FramePacer::SetTargetFrameRate(double targetFrameRate) {
+	m_Period = targetFrameRate > 0.0 ? 1.0 / targetFrameRate : 0.0;
+	m_Started = false;
+}
+
+// Sleep until frame should begin, call before polling input
+void FramePacer::WaitForFrameStart() {
+	Clock::time_point now = Clock::now();
+
+	if (m_Period > 0.0) {
+		std::chrono::duration<double> period(m_Period);
+
+		// Next submit deadline, resynchronise instead of rushing frames after a stall
+		if (!m_Started) {
+			m_Deadline = now + std::chrono::duration_cast<Clock::duration>(period);
+		}
+		else {
+			m_Deadline += std::chrono::duration_cast<Clock::duration>(period);
+			if (m_Deadline < now) {
+				m_Deadline = now + std::chrono::duration_cast<Clock::duration>(period);
+			}
+		}
+
+		// Start as late as the expected CPU work allows
+		Clock::time_point start = m_Deadline - std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(m_WorkEstimate));
+		SleepUntil(start);
+		now = Clock::now();
+	}
+
+	// Time between frame starts
+	if (m_Started) {
+		AddFrameTime(std::chrono::duration<double>(now - m_FrameStart).count());
+	}
+	m_FrameStart = now;
+	m_Started = true;
+}
+
+// Mark CPU work of frame as submitted
+void FramePacer::EndFrame() {
+	double work = std::chrono::duration<double>(Clock::now() - m_FrameStart).count();
+
+	// Track spikes immediately and decay slowly so a slow frame is not predicted short
+	if (work > m_WorkEstimate) {
+		m_WorkEstimate = work;
+	}
+	else {
+		m_WorkEstimate += (work - m_WorkEstimate) * PACER_SMOOTHING;
+	}
+}
+
+// Print frame time statistics since last log and reset them
+void FramePacer::LogStats() {
+	if (m_FrameCount == 0) {
+		return;
+	}
+
+	double variance = m_FrameCount > 1 ? m_FrameTimeM2 / (m_FrameCount - 1) : 0.0;
+	std::cout << std::fixed << std::setprecision(2) << "Frame time: avg " << m_FrameTimeMean * 1000.0 << " ms, stddev " << std::sqrt(variance) * 1000.0
+		<< " ms, min " << m_FrameTimeMin * 1000.0 << " ms, max " << m_FrameTimeMax * 1000.0 << " ms, work " << m_WorkEstimate * 1000.0 << " ms over "
+		<< m_FrameCount << " frames" << std::defaultfloat << std::endl;
+
+	m_FrameCount = 0;
+	m_FrameTimeMean = 0.0;
+	m_FrameTimeM2 = 0.0;
+}
+
+// Sleep most of the way then spin, learning how late sleeps wake
+void FramePacer::SleepUntil(Clock::time_point target) {
+	Clock::time_point now = Clock::now();
+
+	// Sleep while comfortably before target
+	std::chrono::duration<double> remaining = target - now;
+	if (remaining.count() > m_SpinThreshold) {
+		std::chrono::duration<double> sleepTime(remaining.count() - m_SpinThreshold);
+		Clock::time_point sleepEnd = now + std::chrono::duration_cast<Clock::duration>(sleepTime);
+		std::this_thread::sleep_for(sleepTime);
+
+		// Feedback: spin for as long as sleeps tend to overshoot
+		double oversleep = std::chrono::duration<double>(Clock::now() - sleepEnd).count();
+		double threshold = m_SpinThreshold + (oversleep - m_SpinThreshold) * PACER_SMOOTHING;
+		m_SpinThreshold = std::max(threshold, PACER_MIN_SPIN_SECONDS);
+	}
+
+	// Spin out the rest, yielding so other threads can run
+	while (Clock::now() < target) {
+		std::this_thread::yield();
+	}
+}
+
+// Add sample to statistics
+void FramePacer::AddFrameTime(double frameTime) {
+	m_FrameCount++;
+	if (m_FrameCount == 1) {
+		m_FrameTimeMin = frameTime;
+		m_FrameTimeMax = frameTime;
+	}
+	m_FrameTimeMin = std::min(m_FrameTimeMin, frameTime);
+	m_FrameTimeMax = std::max(m_FrameTimeMax, frameTime);
+
+	double delta = frameTime - m_FrameTimeMean;
+	m_FrameTimeMean += delta / m_FrameCount;
+	m_FrameTimeM2 += delta * (frameTime - m_FrameTimeMean);
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+// Sleep shorter than the measured oversleep is finished by spinning
+const double PACER_MIN_SPIN_SECONDS = 0.0005;
+
+// Weight of the newest sample in smoothed timings
+const double PACER_SMOOTHING = 0.1;
+
+// Delays each frame start to the latest moment that still meets the target period
+class FramePacer {
+public:
+	FramePacer(double targetFrameRate);	// Constructor, 0 leaves frame rate unlimited
+	~FramePacer();						// Destructor
+
+	// FUNCTIONS
+	void WaitForFrameStart();		// Sleep until frame should begin, call before polling input
+	void EndFrame();				// Mark CPU work of frame as submitted
+	void LogStats();				// Print frame time statistics since last log and reset them
+
+	// SETTERS
+	void SetTargetFrameRate(double targetFrameRate);	// Change target, 0 leaves frame rate unlimited
+private:
+	typedef std::chrono::high_resolution_clock Clock;
+
+	// VARIABLES
+	double m_Period;				// Target seconds per frame, 0 if unlimited
+	Clock::time_point m_Deadline;	// When the current frame should be submitted
+	Clock::time_point m_FrameStart;	// When the current frame began
+	bool m_Started;					// True after first frame
+	double m_WorkEstimate;			// Smoothed CPU seconds from frame start to submit
+	double m_SpinThreshold;			// Smoothed oversleep of the OS sleep, remaining time below this is spun
+
+	// Frame time statistics, Welford's running variance
+	uint32_t m_FrameCount;			// Frames since last log
+	double m_FrameTimeMean;			// Mean seconds between frame starts
+	double m_FrameTimeM2;			// Sum of squared differences from mean
+	double m_FrameTimeMin;			// Shortest frame
+	double m_FrameTimeMax;			// Longest frame
+
+	// FUNCTIONS
+	void SleepUntil(Clock::time_point target);	// Sleep most of the way then spin, learning how late sleeps wake
+	void AddFrameTime(double frameTime);		// Add sample to statistics
+};
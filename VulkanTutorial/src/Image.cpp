@@ -3,11 +3,11 @@
 #include <stdexcept>
 
 // Constructor
-Image::Image(Device* device, CommandPool* commandPool, int32_t width, int32_t height, uint32_t mipLevels, VkSampleCountFlagBits numSamples, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImageAspectFlags aspectFlags)
-: m_Device(device), m_CommandPool(commandPool), m_Format(format), m_MipLevels(mipLevels), m_Width(width), m_Height(height) {
+Image::Image(Device* device, CommandPool* commandPool, int32_t width, int32_t height, uint32_t mipLevels, VkSampleCountFlagBits numSamples, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImageAspectFlags aspectFlags, bool deferMemory)
+: m_ImageView(VK_NULL_HANDLE), m_OwnsMemory(!deferMemory), m_Device(device), m_CommandPool(commandPool), m_ImageInfo({}), m_Properties(properties), m_AspectFlags(aspectFlags), m_Layout(VK_IMAGE_LAYOUT_UNDEFINED), m_Format(format), m_MipLevels(mipLevels), m_Width(width), m_Height(height) {
 
 	// Image creation info
-	VkImageCreateInfo imageInfo = {};
+	VkImageCreateInfo& imageInfo = m_ImageInfo;
 	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
 	imageInfo.imageType = VK_IMAGE_TYPE_2D;
 	imageInfo.extent.width = m_Width;
@@ -27,43 +27,36 @@ Image::Image(Device* device, CommandPool* commandPool, int32_t width, int32_t he
 	}
 
 	// Get memory requirements
-	VkMemoryRequirements memRequirements;
-	vkGetImageMemoryRequirements(m_Device->GetDevice(), m_Image, &memRequirements);
+	vkGetImageMemoryRequirements(m_Device->GetDevice(), m_Image, &m_MemoryRequirements);
 
-	// Memory allocation info
-	VkMemoryAllocateInfo allocInfo = {};
-	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocInfo.allocationSize = memRequirements.size;
-	allocInfo.memoryTypeIndex = FindMemoryType(memRequirements.memoryTypeBits, properties);
+	// Memory is bound later by whoever aliases it
+	if (deferMemory) {
+		return;
+	}
 
-	// Allocate memory
-	if (vkAllocateMemory(m_Device->GetDevice(), &allocInfo, nullptr, &m_ImageMemory) != VK_SUCCESS) {
-		throw std::runtime_error("Failed to allocate image memory!");
+	// Account memory as attachment or texture
+	MemoryCategory category = MEMORY_CATEGORY_OTHER;
+	if (usage & (VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT)) {
+		category = MEMORY_CATEGORY_ATTACHMENT;
+	}
+	else if (usage & VK_IMAGE_USAGE_SAMPLED_BIT) {
+		category = MEMORY_CATEGORY_TEXTURE;
 	}
 
-	// Bind image to image memory
-	vkBindImageMemory(m_Device->GetDevice(), m_Image, m_ImageMemory, 0);
+	// Transient attachments are never stored, prefer memory that is only committed when tiles spill
+	VkMemoryPropertyFlags preferredProperties = 0;
+	if (usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) {
+		preferredProperties = VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+	}
 
-	// Image view creation data
-	VkImageViewCreateInfo createInfo = {};
-	createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-	createInfo.image = m_Image;
-	createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-	createInfo.format = format;
-	createInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
-	createInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
-	createInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
-	createInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
-	createInfo.subresourceRange.aspectMask = aspectFlags;
-	createInfo.subresourceRange.baseMipLevel = 0;
-	createInfo.subresourceRange.levelCount = mipLevels;
-	createInfo.subresourceRange.baseArrayLayer = 0;
-	createInfo.subresourceRange.layerCount = 1;
+	// Allocate memory
+	m_Allocation = m_Device->GetAllocator()->Allocate(m_MemoryRequirements, properties, category, preferredProperties);
+
+	// Bind image to image memory
+	vkBindImageMemory(m_Device->GetDevice(), m_Image, m_Allocation.memory, m_Allocation.offset);
 
 	// Create image view
-	if (vkCreateImageView(m_Device->GetDevice(), &createInfo, nullptr, &m_ImageView) != VK_SUCCESS) {
-		throw std::runtime_error("Failed to create image views!");
-	}
+	m_ImageView = CreateImageView(m_Image);
 
 }
 
@@ -72,14 +65,37 @@ Image::~Image(){
 	// Destroy image and free memory
 	vkDestroyImageView(m_Device->GetDevice(), m_ImageView, nullptr);
 	vkDestroyImage(m_Device->GetDevice(), m_Image, nullptr);
-	vkFreeMemory(m_Device->GetDevice(), m_ImageMemory, nullptr);
+
+	// Aliased memory belongs to its owner
+	if (m_OwnsMemory) {
+		m_Device->GetAllocator()->Free(m_Allocation);
+	}
+}
+
+// Bind memory shared with other images, caller keeps ownership
+void Image::BindMemory(const Allocation& memory) {
+	// Check image fits the shared memory
+	if (!(m_MemoryRequirements.memoryTypeBits & (1 << memory.memoryTypeIndex)) || m_MemoryRequirements.size > memory.size || memory.offset % m_MemoryRequirements.alignment != 0) {
+		throw std::runtime_error("Image cannot alias memory!");
+	}
+
+	// Bind image to shared memory
+	m_Allocation = memory;
+	vkBindImageMemory(m_Device->GetDevice(), m_Image, m_Allocation.memory, m_Allocation.offset);
+
+	// Create image view
+	m_ImageView = CreateImageView(m_Image);
 }
 
 // Copy a buffer of data to image
 void Image::CopyBufferToImage(VkBuffer buffer, uint32_t width, uint32_t height) {
-	// Create command
 	VkCommandBuffer commandBuffer = m_CommandPool->BeginSingleTimeCommands();
+	CopyBufferToImage(commandBuffer, buffer, width, height);
+	m_CommandPool->EndSingleTimeCommands(commandBuffer);
+}
 
+// Record copy of a buffer of data to image
+void Image::CopyBufferToImage(VkCommandBuffer commandBuffer, VkBuffer buffer, uint32_t width, uint32_t height) {
 	// Buffer image copy information
 	VkBufferImageCopy region = {};
 	region.bufferOffset = 0;
@@ -94,16 +110,17 @@ void Image::CopyBufferToImage(VkBuffer buffer, uint32_t width, uint32_t height)
 
 	// Copy buffer to image
 	vkCmdCopyBufferToImage(commandBuffer, buffer, m_Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-
-	// End commands
-	m_CommandPool->EndSingleTimeCommands(commandBuffer);
 }
 
+// Transition image layout
 void Image::TransitionImageLayout(VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels) {
-
-	// Start command buffer
 	VkCommandBuffer commandBuffer = m_CommandPool->BeginSingleTimeCommands();
+	TransitionImageLayout(commandBuffer, oldLayout, newLayout, mipLevels);
+	m_CommandPool->EndSingleTimeCommands(commandBuffer);
+}
 
+// Record image layout transition
+void Image::TransitionImageLayout(VkCommandBuffer commandBuffer, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels) {
 	// Image memory barrier info
 	VkImageMemoryBarrier barrier = {};
 	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
@@ -113,12 +130,12 @@ void Image::TransitionImageLayout(VkImageLayout oldLayout, VkImageLayout newLayo
 	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
 	barrier.image = m_Image;
 	barrier.subresourceRange.baseMipLevel = 0;
-	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.levelCount = mipLevels;
 	barrier.subresourceRange.baseArrayLayer = 0;
 	barrier.subresourceRange.layerCount = 1;
 
 	// Check which aspect to use
-	if (newLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL) {
+	if (m_AspectFlags & VK_IMAGE_ASPECT_DEPTH_BIT) {
 		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
 
 		// Check for stencil attachment
@@ -130,56 +147,101 @@ void Image::TransitionImageLayout(VkImageLayout oldLayout, VkImageLayout newLayo
 		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 	}
 
+	// Wait for whatever last used the old layout before the first use of the new one
 	VkPipelineStageFlags sourceStage, destinationStage;
-
-	if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
-		barrier.srcAccessMask = 0;
-		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-		sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-		destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-	}
-	else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
-		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-		sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-		destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-	}
-	else if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL) {
-		barrier.srcAccessMask = 0;
-		barrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-		sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-		destinationStage = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-	}
-	else {
-		throw std::invalid_argument("Unsupported layout transition!");
-	}
+	GetLayoutAccess(oldLayout, barrier.srcAccessMask, sourceStage);
+	GetLayoutAccess(newLayout, barrier.dstAccessMask, destinationStage);
 
 	// Pipeline barrier command
 	vkCmdPipelineBarrier(commandBuffer, sourceStage, destinationStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+	m_Layout = newLayout;
+}
 
-	// End command buffer
-	m_CommandPool->EndSingleTimeCommands(commandBuffer);
-
+// Accesses and stages of an image in layout
+void Image::GetLayoutAccess(VkImageLayout layout, VkAccessFlags& access, VkPipelineStageFlags& stage) {
+	switch (layout) {
+	case VK_IMAGE_LAYOUT_UNDEFINED:
+	case VK_IMAGE_LAYOUT_PREINITIALIZED:
+		access = 0;
+		stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+		break;
+	case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+		access = VK_ACCESS_TRANSFER_READ_BIT;
+		stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		break;
+	case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
+		access = VK_ACCESS_TRANSFER_WRITE_BIT;
+		stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		break;
+	case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+		access = VK_ACCESS_SHADER_READ_BIT;
+		stage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		break;
+	case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
+		access = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		stage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		break;
+	case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
+		access = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		stage = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		break;
+	case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:
+		access = 0;
+		stage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+		break;
+	default:
+		throw std::invalid_argument("Unsupported layout transition!");
+	}
 }
 
-// Find required memory type
-uint32_t Image::FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties){
-	// Get memory properties
-	VkPhysicalDeviceMemoryProperties memProperties;
-	vkGetPhysicalDeviceMemoryProperties(m_Device->GetPhysicalDevice(), &memProperties);
+// Create view over all mip levels of image
+VkImageView Image::CreateImageView(VkImage image) {
+	// Image view creation data
+	VkImageViewCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	createInfo.image = image;
+	createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	createInfo.format = m_Format;
+	createInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+	createInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+	createInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+	createInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+	createInfo.subresourceRange.aspectMask = m_AspectFlags;
+	createInfo.subresourceRange.baseMipLevel = 0;
+	createInfo.subresourceRange.levelCount = m_MipLevels;
+	createInfo.subresourceRange.baseArrayLayer = 0;
+	createInfo.subresourceRange.layerCount = 1;
 
-	// Find suitable memory type
-	for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
-		if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
-			return i;
-		}
+	// Create image view
+	VkImageView imageView;
+	if (vkCreateImageView(m_Device->GetDevice(), &createInfo, nullptr, &imageView) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create image views!");
 	}
 
-	throw std::runtime_error("Failed to find suitable memory type!");
+	return imageView;
+}
+
+// True if defragmentation may move image
+bool Image::IsRelocatable() {
+	// Only single sampled device local images which are fully uploaded and copyable
+	VkImageUsageFlags transferUsage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	return m_OwnsMemory
+		&& (m_ImageInfo.usage & transferUsage) == transferUsage
+		&& m_ImageInfo.samples == VK_SAMPLE_COUNT_1_BIT
+		&& m_ImageInfo.tiling == VK_IMAGE_TILING_OPTIMAL
+		&& m_Layout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+		&& !(m_Properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
 }
 
 // Generate mip maps for image
 void Image::GenerateMipmaps(){
+	VkCommandBuffer commandBuffer = m_CommandPool->BeginSingleTimeCommands();
+	GenerateMipmaps(commandBuffer);
+	m_CommandPool->EndSingleTimeCommands(commandBuffer);
+}
+
+// Record mip map generation for image
+void Image::GenerateMipmaps(VkCommandBuffer commandBuffer){
 
 	// Check if image format supports linear blitting
 	VkFormatProperties formatProperties;
@@ -188,9 +250,6 @@ void Image::GenerateMipmaps(){
 		throw std::runtime_error("Texture image format does not support linear blitting!");
 	}
 
-	// Create command buffer
-	VkCommandBuffer commandBuffer = m_CommandPool->BeginSingleTimeCommands();
-
 	// Barrier data
 	VkImageMemoryBarrier barrier = {};
 	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
@@ -261,8 +320,5 @@ void Image::GenerateMipmaps(){
 
 	// Apply barrier
 	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
-
-	// End commands
-	m_CommandPool->EndSingleTimeCommands(commandBuffer);
-
+	m_Layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 }
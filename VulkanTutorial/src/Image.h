@@ -3,33 +3,50 @@
 #include "vulkan/vulkan.h"
 #include "Device.h"
 #include "CommandPool.h"
+#include "MemoryAllocator.h"
 
 class Image {
 public:
-	Image(Device* device, CommandPool* commandPool, int32_t width, int32_t height, uint32_t mipLevels, VkSampleCountFlagBits numSamples, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImageAspectFlags aspectFlags);	// Constructor
+	Image(Device* device, CommandPool* commandPool, int32_t width, int32_t height, uint32_t mipLevels, VkSampleCountFlagBits numSamples, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImageAspectFlags aspectFlags, bool deferMemory = false);	// Constructor, deferMemory leaves memory to BindMemory
 	~Image();	// Destructor
 
 	// FUNCTIONS
 	void CopyBufferToImage(VkBuffer buffer, uint32_t width, uint32_t height);			// Copy buffer of data to image
-	void TransitionImageLayout(VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels);
+	void CopyBufferToImage(VkCommandBuffer commandBuffer, VkBuffer buffer, uint32_t width, uint32_t height);	// Record copy of buffer of data to image
+	void TransitionImageLayout(VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels);		// Transition image layout
+	void TransitionImageLayout(VkCommandBuffer commandBuffer, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels);	// Record image layout transition
 	void GenerateMipmaps();			// Generate mip maps for image
+	void GenerateMipmaps(VkCommandBuffer commandBuffer);	// Record mip map generation for image
+	void BindMemory(const Allocation& memory);	// Bind memory shared with other images, caller keeps ownership
+	bool IsRelocatable();			// True if defragmentation may move image
 
 	// GETTERS
 	VkImage GetImage() { return m_Image; }
-	VkDeviceMemory GetImageMemory() { return m_ImageMemory; }
+	VkDeviceMemory GetImageMemory() { return m_Allocation.memory; }
 	VkImageView GetImageView() { return m_ImageView; }
 	uint32_t GetMipLevels() { return m_MipLevels; }
+	const Allocation& GetAllocation() { return m_Allocation; }
+	const VkMemoryRequirements& GetMemoryRequirements() { return m_MemoryRequirements; }
 private:
 	// VARIABLES
 	VkImage m_Image;				// Vulkan image
-	VkDeviceMemory m_ImageMemory;	// Vulkan image memory
+	Allocation m_Allocation;		// Vulkan image memory
 	VkImageView m_ImageView;		// Vulkan image view
+	bool m_OwnsMemory;				// False if memory is aliased and owned elsewhere
+	VkMemoryRequirements m_MemoryRequirements;	// Memory requirements of image
 	Device* m_Device;				// Device object
 	CommandPool* m_CommandPool;		// Command pool object
+	VkImageCreateInfo m_ImageInfo;	// Image creation info
+	VkMemoryPropertyFlags m_Properties;	// Image memory properties
+	VkImageAspectFlags m_AspectFlags;	// Image view aspect
+	VkImageLayout m_Layout;			// Layout of all mip levels after last recorded operation
 	VkFormat m_Format;				// Image format
 	uint32_t m_MipLevels;			// Mip levels of image
 	int32_t m_Width, m_Height;		// Width and Height of image
 
 	// FUNCTIONS
-	uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);		// Find required memory type
-};
\ No newline at end of file
+	VkImageView CreateImageView(VkImage image);		// Create view over all mip levels of image
+	static void GetLayoutAccess(VkImageLayout layout, VkAccessFlags& access, VkPipelineStageFlags& stage);	// Accesses and stages of an image in layout
+
+	friend class Defragmenter;		// Defragmenter swaps image and memory when relocating
+};
@@ -0,0 +1,245 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <exception>
+
+// Scheduled task, finished once its function has run
+struct Job {
+	std::function<void()> task;					// Function to run
+	std::atomic<uint32_t> remainingDependencies;	// Unfinished dependencies plus one while scheduling
+	std::atomic<bool> finished;					// True after task ran
+	JobPriority priority;						// Queue task is run from
+	std::exception_ptr exception;				// Exception thrown by task
+	std::mutex mutex;							// Guards dependents and finishing
+	std::vector<JobHandle> dependents;			// Tasks waiting on this one
+};
+
+// Index of the worker running on this thread, -1 on other threads
+static thread_local int32_t s_WorkerIndex = -1;
+
+// Constructor, 0 uses one worker per core besides the calling thread
+JobSystem::JobSystem(uint32_t workerCount) : m_QueuedCount(0), m_NextWorker(0), m_Stopping(false) {
+	if (workerCount == 0) {
+		workerCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+	}
+
+	// Create deques before any thread can steal from them
+	for (uint32_t i = 0; i < workerCount; i++) {
+		m_Workers.push_back(std::unique_ptr<Worker>(new Worker()));
+	}
+	for (uint32_t i = 0; i < workerCount; i++) {
+		m_Workers[i]->thread = std::thread(&JobSystem::WorkerLoop, this, i);
+	}
+}
+
+// Destructor, finishes queued tasks
+JobSystem::~JobSystem() {
+	// Tell workers to exit once deques are empty
+	{
+		std::lock_guard<std::mutex> lock(m_SleepMutex);
+		m_Stopping = true;
+	}
+	m_WakeCondition.notify_all();
+	for (std::unique_ptr<Worker>& worker : m_Workers) {
+		worker->thread.join();
+	}
+}
+
+// Run task once every dependency has finished
+JobHandle JobSystem::Schedule(std::function<void()> task, const std::vector<JobHandle>& dependencies, JobPriority priority) {
+	JobHandle job = std::make_shared<Job>();
+	job->task = std::move(task);
+	job->finished = false;
+	job->priority = priority;
+
+	// Hold one count so the job cannot start while dependencies are being registered
+	job->remainingDependencies = static_cast<uint32_t>(dependencies.size()) + 1;
+	for (const JobHandle& dependency : dependencies) {
+		std::lock_guard<std::mutex> lock(dependency->mutex);
+		if (dependency->finished) {
+			job->remainingDependencies--;
+		}
+		else {
+			dependency->dependents.push_back(job);
+		}
+	}
+
+	// Queue now if nothing is left to wait for
+	if (--job->remainingDependencies == 0) {
+		Enqueue(job);
+	}
+	return job;
+}
+
+// Run tasks until job has finished, rethrows its exception
+void JobSystem::Wait(const JobHandle& job) {
+	// Waiting on frame work never picks up a long background task
+	bool background = job->priority == JOB_PRIORITY_BACKGROUND;
+	while (!job->finished) {
+		if (!RunNext(background)) {
+			std::this_thread::yield();
+		}
+	}
+
+	if (job->exception) {
+		std::rethrow_exception(job->exception);
+	}
+}
+
+// True if job has run, without waiting
+bool JobSystem::IsFinished(const JobHandle& job) {
+	return job->finished;
+}
+
+// Run job for every index, grainSize indices per task, and wait
+void JobSystem::ParallelFor(uint32_t count, const std::function<void(uint32_t index)>& job, uint32_t grainSize) {
+	grainSize = std::max(grainSize, 1u);
+
+	// One task per chunk of indices
+	std::vector<JobHandle> chunks;
+	for (uint32_t first = 0; first < count; first += grainSize) {
+		uint32_t last = std::min(first + grainSize, count);
+		chunks.push_back(Schedule([&job, first, last]() {
+			for (uint32_t i = first; i < last; i++) {
+				job(i);
+			}
+		}));
+	}
+
+	// Help until every chunk is done, chunks reference job so none may still run when an exception leaves
+	std::exception_ptr exception;
+	for (const JobHandle& chunk : chunks) {
+		try {
+			Wait(chunk);
+		}
+		catch (...) {
+			if (!exception) {
+				exception = std::current_exception();
+			}
+		}
+	}
+	if (exception) {
+		std::rethrow_exception(exception);
+	}
+}
+
+// Run and steal tasks until stopped
+void JobSystem::WorkerLoop(uint32_t index) {
+	s_WorkerIndex = static_cast<int32_t>(index);
+
+	while (true) {
+		if (RunNext(true)) {
+			continue;
+		}
+
+		// Sleep until a task is queued
+		std::unique_lock<std::mutex> lock(m_SleepMutex);
+		m_WakeCondition.wait(lock, [this]() { return m_Stopping || m_QueuedCount > 0; });
+		if (m_Stopping && m_QueuedCount == 0) {
+			return;
+		}
+	}
+}
+
+// Queue ready task on this thread's deque
+void JobSystem::Enqueue(const JobHandle& job) {
+	if (job->priority == JOB_PRIORITY_BACKGROUND) {
+		std::lock_guard<std::mutex> lock(m_BackgroundMutex);
+		m_BackgroundJobs.push_back(job);
+	}
+	else {
+		// Workers keep their tasks local, other threads spread them round robin
+		uint32_t index = s_WorkerIndex >= 0 ? static_cast<uint32_t>(s_WorkerIndex) : m_NextWorker++ % m_Workers.size();
+		std::lock_guard<std::mutex> lock(m_Workers[index]->mutex);
+		m_Workers[index]->jobs.push_back(job);
+	}
+	m_QueuedCount++;
+
+	// Lock so a worker between checking for tasks and sleeping cannot miss the wake up
+	{
+		std::lock_guard<std::mutex> lock(m_SleepMutex);
+	}
+	m_WakeCondition.notify_one();
+}
+
+// Run one queued task, background ones only if allowed, false if none was found
+bool JobSystem::RunNext(bool background) {
+	JobHandle job;
+	if (s_WorkerIndex >= 0) {
+		job = Pop(static_cast<uint32_t>(s_WorkerIndex));
+	}
+	if (!job) {
+		job = Steal(s_WorkerIndex >= 0 ? static_cast<uint32_t>(s_WorkerIndex) : 0);
+	}
+
+	// Background tasks once no normal task is ready
+	if (!job && background) {
+		std::lock_guard<std::mutex> lock(m_BackgroundMutex);
+		if (!m_BackgroundJobs.empty()) {
+			job = m_BackgroundJobs.front();
+			m_BackgroundJobs.pop_front();
+			m_QueuedCount--;
+		}
+	}
+	if (!job) {
+		return false;
+	}
+
+	Run(job);
+	return true;
+}
+
+// Take newest task of own deque
+JobHandle JobSystem::Pop(uint32_t index) {
+	Worker& worker = *m_Workers[index];
+	std::lock_guard<std::mutex> lock(worker.mutex);
+	if (worker.jobs.empty()) {
+		return nullptr;
+	}
+
+	JobHandle job = worker.jobs.back();
+	worker.jobs.pop_back();
+	m_QueuedCount--;
+	return job;
+}
+
+// Take oldest task of another deque
+JobHandle JobSystem::Steal(uint32_t thief) {
+	// Visit deques starting after the thief's own
+	for (size_t offset = 1; offset <= m_Workers.size(); offset++) {
+		Worker& victim = *m_Workers[(thief + offset) % m_Workers.size()];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.jobs.empty()) {
+			JobHandle job = victim.jobs.front();
+			victim.jobs.pop_front();
+			m_QueuedCount--;
+			return job;
+		}
+	}
+	return nullptr;
+}
+
+// Execute task and release its dependents
+void JobSystem::Run(const JobHandle& job) {
+	try {
+		job->task();
+	}
+	catch (...) {
+		job->exception = std::current_exception();
+	}
+
+	// Mark finished and take dependents under the lock Schedule registers them with
+	std::vector<JobHandle> dependents;
+	{
+		std::lock_guard<std::mutex> lock(job->mutex);
+		job->finished = true;
+		dependents.swap(job->dependents);
+	}
+
+	// Queue dependents whose last dependency this was
+	for (const JobHandle& dependent : dependents) {
+		if (--dependent->remainingDependencies == 0) {
+			Enqueue(dependent);
+		}
+	}
+}
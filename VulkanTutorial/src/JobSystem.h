@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Scheduled task, finished once its function has run
+struct Job;
+typedef std::shared_ptr<Job> JobHandle;
+
+// Background tasks only run on workers, or on threads waiting on a background task
+typedef enum JobPriority {
+	JOB_PRIORITY_NORMAL,
+	JOB_PRIORITY_BACKGROUND
+} JobPriority;
+
+// Work-stealing task scheduler, waiting threads run other tasks
+class JobSystem {
+public:
+	JobSystem(uint32_t workerCount = 0);	// Constructor, 0 uses one worker per core besides the calling thread
+	~JobSystem();							// Destructor, finishes queued tasks
+
+	// FUNCTIONS
+	JobHandle Schedule(std::function<void()> task, const std::vector<JobHandle>& dependencies = {}, JobPriority priority = JOB_PRIORITY_NORMAL);	// Run task once every dependency has finished
+	void Wait(const JobHandle& job);		// Run tasks until job has finished, rethrows its exception
+	void ParallelFor(uint32_t count, const std::function<void(uint32_t index)>& job, uint32_t grainSize = 1);	// Run job for every index, grainSize indices per task, and wait
+	static bool IsFinished(const JobHandle& job);	// True if job has run, without waiting
+
+	// GETTERS
+	uint32_t GetThreadCount() { return static_cast<uint32_t>(m_Workers.size()) + 1; }	// Workers plus the waiting caller
+private:
+	// STRUCTS
+	struct Worker {
+		std::thread thread;					// Worker thread
+		std::deque<JobHandle> jobs;			// Ready tasks, owner uses the back, thieves the front
+		std::mutex mutex;					// Guards jobs
+	};
+
+	// VARIABLES
+	std::vector<std::unique_ptr<Worker>> m_Workers;	// Worker threads and their deques
+	std::deque<JobHandle> m_BackgroundJobs;	// Ready background tasks, oldest first
+	std::mutex m_BackgroundMutex;			// Guards background tasks
+	std::atomic<uint32_t> m_QueuedCount;	// Ready tasks in all deques
+	std::atomic<uint32_t> m_NextWorker;		// Deque receiving tasks from non-worker threads
+	std::mutex m_SleepMutex;				// Guards sleeping workers
+	std::condition_variable m_WakeCondition;	// Wakes workers when tasks are queued
+	bool m_Stopping;						// True when workers should exit
+
+	// FUNCTIONS
+	void WorkerLoop(uint32_t index);		// Run and steal tasks until stopped
+	void Enqueue(const JobHandle& job);		// Queue ready task on this thread's deque
+	bool RunNext(bool background);			// Run one queued task, background ones only if allowed, false if none was found
+	JobHandle Pop(uint32_t index);			// Take newest task of own deque
+	JobHandle Steal(uint32_t thief);		// Take oldest task of another deque
+	void Run(const JobHandle& job);			// Execute task and release its dependents
+};
@@ -0,0 +1,156 @@
+#include "LayoutCache.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+// Constructor
+LayoutCache::LayoutCache(VkDevice device) : m_Device(device) {
+}
+
+// Destructor, destroys every layout
+LayoutCache::~LayoutCache() {
+	for (auto& pipelineLayout : m_PipelineLayouts) {
+		vkDestroyPipelineLayout(m_Device, pipelineLayout.second, nullptr);
+	}
+	for (auto& descriptorSetLayout : m_DescriptorSetLayouts) {
+		vkDestroyDescriptorSetLayout(m_Device, descriptorSetLayout.second, nullptr);
+	}
+}
+
+// Set layout of bindings, immutable samplers are not supported
+VkDescriptorSetLayout LayoutCache::GetDescriptorSetLayout(std::vector<VkDescriptorSetLayoutBinding> bindings) {
+	// Declaration order does not change the layout
+	std::sort(bindings.begin(), bindings.end(), [](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) {
+		return a.binding < b.binding;
+	});
+
+	std::vector<uint32_t> key;
+	for (const VkDescriptorSetLayoutBinding& binding : bindings) {
+		if (binding.pImmutableSamplers != nullptr) {
+			throw std::invalid_argument("Layout cache does not support immutable samplers!");
+		}
+		key.insert(key.end(), { binding.binding, static_cast<uint32_t>(binding.descriptorType), binding.descriptorCount, binding.stageFlags });
+	}
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	auto found = m_DescriptorSetLayouts.find(key);
+	if (found != m_DescriptorSetLayouts.end()) {
+		return found->second;
+	}
+
+	// Descriptor set layout creation info
+	VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	layoutInfo.pBindings = bindings.data();
+
+	// Create descriptor set layout
+	VkDescriptorSetLayout descriptorSetLayout;
+	if (vkCreateDescriptorSetLayout(m_Device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create descriptor set layout!");
+	}
+
+	m_DescriptorSetLayouts[key] = descriptorSetLayout;
+	return descriptorSetLayout;
+}
+
+// Pipeline layout of set layouts and push constants
+VkPipelineLayout LayoutCache::GetPipelineLayout(const std::vector<VkDescriptorSetLayout>& setLayouts, const std::vector<VkPushConstantRange>& pushConstantRanges) {
+	// Set layouts are deduplicated, so equal handles mean equal layouts
+	std::vector<uint64_t> key;
+	key.push_back(setLayouts.size());
+	for (VkDescriptorSetLayout setLayout : setLayouts) {
+		key.push_back((uint64_t)setLayout);
+	}
+	for (const VkPushConstantRange& range : pushConstantRanges) {
+		key.insert(key.end(), { range.stageFlags, range.offset, range.size });
+	}
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	auto found = m_PipelineLayouts.find(key);
+	if (found != m_PipelineLayouts.end()) {
+		return found->second;
+	}
+
+	// Pipeline layout creation info
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+	pipelineLayoutInfo.pSetLayouts = setLayouts.data();
+	pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(pushConstantRanges.size());
+	pipelineLayoutInfo.pPushConstantRanges = pushConstantRanges.data();
+
+	// Create pipeline layout
+	VkPipelineLayout pipelineLayout;
+	if (vkCreatePipelineLayout(m_Device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create pipeline layout!");
+	}
+
+	m_PipelineLayouts[key] = pipelineLayout;
+	return pipelineLayout;
+}
+
+// Layouts of reflected stages, bindings shared by stages are merged, external sets are used as given
+ShaderLayout LayoutCache::GetShaderLayout(const std::vector<const ShaderReflection*>& stages, const std::map<uint32_t, VkDescriptorSetLayout>& externalSets) {
+	// Bindings of every set, a binding used by several stages is visible to all of them
+	std::vector<std::map<uint32_t, VkDescriptorSetLayoutBinding>> sets;
+	std::vector<VkPushConstantRange> pushConstantRanges;
+	for (const ShaderReflection* stage : stages) {
+		for (const ReflectedBinding& reflected : stage->GetBindings()) {
+			// Sets such as bindless tables are laid out by their owner
+			if (externalSets.count(reflected.set) != 0) {
+				continue;
+			}
+			if (reflected.count == 0) {
+				throw std::runtime_error("Runtime sized descriptor array at set " + std::to_string(reflected.set) + " binding " + std::to_string(reflected.binding) + " needs an explicit size!");
+			}
+			if (reflected.set >= sets.size()) {
+				sets.resize(reflected.set + 1);
+			}
+
+			auto found = sets[reflected.set].find(reflected.binding);
+			if (found == sets[reflected.set].end()) {
+				VkDescriptorSetLayoutBinding binding = {};
+				binding.binding = reflected.binding;
+				binding.descriptorType = reflected.type;
+				binding.descriptorCount = reflected.count;
+				binding.stageFlags = stage->GetStage();
+				binding.pImmutableSamplers = nullptr;
+				sets[reflected.set][reflected.binding] = binding;
+			}
+			else if (found->second.descriptorType != reflected.type || found->second.descriptorCount != reflected.count) {
+				throw std::runtime_error("Shader stages disagree on set " + std::to_string(reflected.set) + " binding " + std::to_string(reflected.binding) + "!");
+			}
+			else {
+				found->second.stageFlags |= stage->GetStage();
+			}
+		}
+
+		// One range per stage, each stage sees the block from offset 0
+		if (stage->GetPushConstantSize() > 0) {
+			pushConstantRanges.push_back({ static_cast<VkShaderStageFlags>(stage->GetStage()), 0, stage->GetPushConstantSize() });
+		}
+	}
+
+	// Layouts of every set, unused set indices get empty layouts
+	if (!externalSets.empty() && externalSets.rbegin()->first >= sets.size()) {
+		sets.resize(externalSets.rbegin()->first + 1);
+	}
+	ShaderLayout layout;
+	for (uint32_t set = 0; set < sets.size(); set++) {
+		auto external = externalSets.find(set);
+		if (external != externalSets.end()) {
+			layout.setLayouts.push_back(external->second);
+			continue;
+		}
+
+		std::vector<VkDescriptorSetLayoutBinding> bindings;
+		for (const auto& binding : sets[set]) {
+			bindings.push_back(binding.second);
+		}
+		layout.setLayouts.push_back(GetDescriptorSetLayout(bindings));
+	}
+	layout.pipelineLayout = GetPipelineLayout(layout.setLayouts, pushConstantRanges);
+	return layout;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "vulkan/vulkan.h"
+
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "ShaderReflection.h"
+
+// Layouts of a group of shader stages
+struct ShaderLayout {
+	std::vector<VkDescriptorSetLayout> setLayouts;	// Layout of every set up to the highest used, empty sets in between
+	VkPipelineLayout pipelineLayout;				// Pipeline layout of sets and push constants
+};
+
+// Descriptor set and pipeline layouts by description, alive until the cache is deleted
+class LayoutCache {
+public:
+	LayoutCache(VkDevice device);			// Constructor
+	~LayoutCache();							// Destructor, destroys every layout
+
+	// FUNCTIONS
+	VkDescriptorSetLayout GetDescriptorSetLayout(std::vector<VkDescriptorSetLayoutBinding> bindings);	// Set layout of bindings, immutable samplers are not supported
+	VkPipelineLayout GetPipelineLayout(const std::vector<VkDescriptorSetLayout>& setLayouts, const std::vector<VkPushConstantRange>& pushConstantRanges);	// Pipeline layout of set layouts and push constants
+	ShaderLayout GetShaderLayout(const std::vector<const ShaderReflection*>& stages, const std::map<uint32_t, VkDescriptorSetLayout>& externalSets = {});	// Layouts of reflected stages, bindings shared by stages are merged, external sets are used as given
+
+	// GETTERS
+	size_t GetDescriptorSetLayoutCount() { return m_DescriptorSetLayouts.size(); }
+	size_t GetPipelineLayoutCount() { return m_PipelineLayouts.size(); }
+private:
+	// VARIABLES
+	VkDevice m_Device;						// Vulkan logical device
+	std::map<std::vector<uint32_t>, VkDescriptorSetLayout> m_DescriptorSetLayouts;	// Set layouts by bindings
+	std::map<std::vector<uint64_t>, VkPipelineLayout> m_PipelineLayouts;			// Pipeline layouts by set layouts and push constants
+	std::mutex m_Mutex;						// Guards layouts
+};
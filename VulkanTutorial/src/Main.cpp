@@ -1,12 +1,21 @@
 #include "Application.h"
+#include "Config.h"
 
 #include <iostream>
 
-int main() {
-	Application application;
-
+int main(int argc, char** argv) {
 	try {
-		application.Run();
+		// Settings for this deployment
+		ApplicationConfig config = ParseCommandLine(argc, argv);
+		Application application(config);
+
+		// Run benchmarks instead of rendering when asked
+		if (config.benchmark) {
+			application.RunBenchmarks();
+		}
+		else {
+			application.Run();
+		}
 	}
 	catch (const std::exception& e) {
 		std::cerr << e.what() << std::endl;
@@ -14,4 +23,4 @@ int main() {
 	}
 
 	return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
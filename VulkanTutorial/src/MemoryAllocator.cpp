@@ -0,0 +1,388 @@
+#include "MemoryAllocator.h"
+#include "Device.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+
+// Round value up to a multiple of alignment
+static VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment) {
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+// Account bytes to usage
+static void AddUsage(MemoryUsage& usage, VkDeviceSize size) {
+	usage.current += size;
+	usage.peak = std::max(usage.peak, usage.current);
+	usage.allocationCount++;
+}
+
+// Remove bytes from usage
+static void RemoveUsage(MemoryUsage& usage, VkDeviceSize size) {
+	usage.current -= size;
+	usage.allocationCount--;
+}
+
+// Bytes to mebibytes for logging
+static double ToMiB(VkDeviceSize size) {
+	return static_cast<double>(size) / (1024.0 * 1024.0);
+}
+
+// Constructor
+MemoryAllocator::MemoryAllocator(Device* device) : m_Device(device) {
+	// Query memory types and heaps
+	vkGetPhysicalDeviceMemoryProperties(m_Device->GetPhysicalDevice(), &m_MemoryProperties);
+	m_Blocks.resize(m_MemoryProperties.memoryTypeCount);
+
+	// Buffers and optimal images sharing a block must be granularity aligned
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(m_Device->GetPhysicalDevice(), &properties);
+	m_Granularity = std::max<VkDeviceSize>(properties.limits.bufferImageGranularity, 1);
+
+	// Per heap accounting
+	m_HeapBlockUsage.resize(m_MemoryProperties.memoryHeapCount);
+	m_HeapAllocationUsage.resize(m_MemoryProperties.memoryHeapCount);
+
+	// Driver reported budgets need VK_EXT_memory_budget
+	m_GetMemoryProperties2 = nullptr;
+	if (m_Device->IsExtensionEnabled(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME)) {
+		m_GetMemoryProperties2 = (PFN_vkGetPhysicalDeviceMemoryProperties2KHR)vkGetInstanceProcAddr(m_Device->GetInstance(), "vkGetPhysicalDeviceMemoryProperties2KHR");
+	}
+}
+
+// Destructor
+MemoryAllocator::~MemoryAllocator() {
+	// Free all remaining blocks
+	for (auto& blocks : m_Blocks) {
+		for (MemoryBlock* block : blocks) {
+			DestroyBlock(block);
+		}
+	}
+}
+
+// Allocate memory, creating blocks as needed
+Allocation MemoryAllocator::Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, MemoryCategory category, VkMemoryPropertyFlags preferredProperties) {
+	return AllocateOfType(requirements, FindMemoryType(requirements.memoryTypeBits, properties, preferredProperties), category);
+}
+
+// Allocate memory of a chosen type, creating blocks as needed
+Allocation MemoryAllocator::AllocateOfType(const VkMemoryRequirements& requirements, uint32_t memoryTypeIndex, MemoryCategory category) {
+	// Find sizes
+	VkDeviceSize alignment = std::max(requirements.alignment, m_Granularity);
+	VkDeviceSize size = AlignUp(requirements.size, m_Granularity);
+	VkDeviceSize blockSize = GetBlockSize(memoryTypeIndex);
+
+	Allocation allocation;
+
+	// Large resources get a block of their own, as do lazily allocated ones which gain nothing from sharing
+	bool lazy = (GetMemoryTypeFlags(memoryTypeIndex) & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) != 0;
+	if (size > blockSize / 2 || lazy) {
+		MemoryBlock* block = CreateBlock(memoryTypeIndex, size, true);
+		AllocateFromBlock(block, size, alignment, category, allocation);
+		return allocation;
+	}
+
+	// Try existing blocks first
+	if (AllocateFromExistingBlocks(requirements, memoryTypeIndex, category, nullptr, allocation)) {
+		return allocation;
+	}
+
+	// Otherwise create a new block
+	MemoryBlock* block = CreateBlock(memoryTypeIndex, blockSize, false);
+	AllocateFromBlock(block, size, alignment, category, allocation);
+	return allocation;
+}
+
+// Allocate memory resources with non overlapping lifetimes can share
+Allocation MemoryAllocator::AllocateAliased(const std::vector<VkMemoryRequirements>& requirements, VkMemoryPropertyFlags properties, MemoryCategory category, VkMemoryPropertyFlags preferredProperties) {
+	// Memory must satisfy the largest and strictest resource
+	VkMemoryRequirements merged = {};
+	merged.memoryTypeBits = UINT32_MAX;
+	for (const VkMemoryRequirements& requirement : requirements) {
+		merged.size = std::max(merged.size, requirement.size);
+		merged.alignment = std::max(merged.alignment, requirement.alignment);
+		merged.memoryTypeBits &= requirement.memoryTypeBits;
+	}
+
+	// Check resources share a memory type
+	if (merged.memoryTypeBits == 0) {
+		throw std::runtime_error("Resources have no memory type in common to alias!");
+	}
+
+	return Allocate(merged, properties, category, preferredProperties);
+}
+
+// Allocate without creating blocks
+bool MemoryAllocator::AllocateFromExistingBlocks(const VkMemoryRequirements& requirements, uint32_t memoryTypeIndex, MemoryCategory category, const MemoryBlock* excludedBlock, Allocation& allocation) {
+	VkDeviceSize alignment = std::max(requirements.alignment, m_Granularity);
+	VkDeviceSize size = AlignUp(requirements.size, m_Granularity);
+
+	// Prefer the fullest blocks so sparse ones can drain
+	std::vector<MemoryBlock*> blocks = m_Blocks[memoryTypeIndex];
+	std::sort(blocks.begin(), blocks.end(), [](const MemoryBlock* a, const MemoryBlock* b) {
+		return a->usedSize > b->usedSize;
+	});
+
+	// First fit in each block
+	for (MemoryBlock* block : blocks) {
+		if (block == excludedBlock || block->dedicated) {
+			continue;
+		}
+		if (AllocateFromBlock(block, size, alignment, category, allocation)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// Return allocation to its block
+void MemoryAllocator::Free(Allocation& allocation) {
+	MemoryBlock* block = allocation.block;
+	if (block == nullptr) {
+		return;
+	}
+
+	// Insert free range and merge with neighbours
+	VkDeviceSize offset = allocation.offset;
+	VkDeviceSize size = allocation.size;
+	auto next = block->freeRanges.lower_bound(offset);
+	if (next != block->freeRanges.end() && offset + size == next->first) {
+		size += next->second;
+		next = block->freeRanges.erase(next);
+	}
+	if (next != block->freeRanges.begin()) {
+		auto previous = std::prev(next);
+		if (previous->first + previous->second == offset) {
+			offset = previous->first;
+			size += previous->second;
+			block->freeRanges.erase(previous);
+		}
+	}
+	block->freeRanges[offset] = size;
+
+	// Update block usage and accounting
+	block->usedSize -= allocation.size;
+	block->allocationCount--;
+	RemoveUsage(m_CategoryUsage[allocation.category], allocation.size);
+	RemoveUsage(m_HeapAllocationUsage[GetHeapIndex(block->memoryTypeIndex)], allocation.size);
+	allocation = Allocation();
+
+	// Release empty blocks, keeping one spare block per memory type
+	if (block->allocationCount == 0) {
+		auto& blocks = m_Blocks[block->memoryTypeIndex];
+		if (block->dedicated || blocks.size() > 1) {
+			blocks.erase(std::find(blocks.begin(), blocks.end(), block));
+			DestroyBlock(block);
+		}
+	}
+}
+
+// Usage and budget of every heap
+std::vector<HeapBudget> MemoryAllocator::GetHeapBudgets() {
+	std::vector<HeapBudget> budgets(m_MemoryProperties.memoryHeapCount);
+
+	// Fill in our own accounting, estimate budget as most of the heap
+	for (uint32_t i = 0; i < m_MemoryProperties.memoryHeapCount; i++) {
+		budgets[i].size = m_MemoryProperties.memoryHeaps[i].size;
+		budgets[i].blocks = m_HeapBlockUsage[i];
+		budgets[i].allocations = m_HeapAllocationUsage[i];
+		budgets[i].usage = m_HeapBlockUsage[i].current;
+		budgets[i].budget = budgets[i].size * 8 / 10;
+		budgets[i].deviceLocal = (m_MemoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+	}
+
+	// Use driver figures, which include other processes, when available
+	if (m_GetMemoryProperties2 != nullptr) {
+		VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties = {};
+		budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+		VkPhysicalDeviceMemoryProperties2 memoryProperties = {};
+		memoryProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+		memoryProperties.pNext = &budgetProperties;
+		m_GetMemoryProperties2(m_Device->GetPhysicalDevice(), &memoryProperties);
+
+		for (uint32_t i = 0; i < m_MemoryProperties.memoryHeapCount; i++) {
+			budgets[i].usage = budgetProperties.heapUsage[i];
+			budgets[i].budget = budgetProperties.heapBudget[i];
+		}
+	}
+
+	return budgets;
+}
+
+// Print one line summary of heaps and categories
+void MemoryAllocator::LogUsage() {
+	std::vector<HeapBudget> budgets = GetHeapBudgets();
+
+	std::cout << std::fixed << std::setprecision(1) << "Memory:";
+
+	// Heaps we allocate from: our usage, peak and remaining budget
+	for (uint32_t i = 0; i < budgets.size(); i++) {
+		if (budgets[i].blocks.peak == 0) {
+			continue;
+		}
+		VkDeviceSize headroom = budgets[i].budget > budgets[i].usage ? budgets[i].budget - budgets[i].usage : 0;
+		std::cout << " heap " << i << (budgets[i].deviceLocal ? " (device)" : " (host)")
+			<< " " << ToMiB(budgets[i].blocks.current) << " MiB (peak " << ToMiB(budgets[i].blocks.peak)
+			<< ", headroom " << ToMiB(headroom) << " MiB) |";
+	}
+
+	// Categories with live allocations
+	for (int category = 0; category < MEMORY_CATEGORY_COUNT; category++) {
+		const MemoryUsage& usage = m_CategoryUsage[category];
+		if (usage.peak == 0) {
+			continue;
+		}
+		std::cout << " " << GetCategoryName(static_cast<MemoryCategory>(category)) << " " << ToMiB(usage.current)
+			<< " MiB (peak " << ToMiB(usage.peak) << ")";
+	}
+
+	std::cout << std::defaultfloat << std::endl;
+}
+
+// Name of category for logging
+const char* MemoryAllocator::GetCategoryName(MemoryCategory category) {
+	switch (category) {
+	case MEMORY_CATEGORY_VERTEX: return "vertex";
+	case MEMORY_CATEGORY_INDEX: return "index";
+	case MEMORY_CATEGORY_UNIFORM: return "uniform";
+	case MEMORY_CATEGORY_TEXTURE: return "texture";
+	case MEMORY_CATEGORY_ATTACHMENT: return "attachment";
+	case MEMORY_CATEGORY_STAGING: return "staging";
+	default: return "other";
+	}
+}
+
+// Find appropriate memory type
+uint32_t MemoryAllocator::FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties, VkMemoryPropertyFlags preferredProperties) {
+	// Try preferred properties first
+	if (preferredProperties != 0) {
+		VkMemoryPropertyFlags allProperties = properties | preferredProperties;
+		for (uint32_t i = 0; i < m_MemoryProperties.memoryTypeCount; i++) {
+			if ((typeFilter & (1 << i)) && (m_MemoryProperties.memoryTypes[i].propertyFlags & allProperties) == allProperties) {
+				return i;
+			}
+		}
+	}
+
+	// Find suitable memory type
+	for (uint32_t i = 0; i < m_MemoryProperties.memoryTypeCount; i++) {
+		if ((typeFilter & (1 << i)) && (m_MemoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+			return i;
+		}
+	}
+
+	throw std::runtime_error("Failed to find suitable memory type!");
+}
+
+// Host visible device local type on a heap big enough to hold resources, false if none
+bool MemoryAllocator::FindDirectUploadMemoryType(uint32_t typeFilter, uint32_t& memoryTypeIndex) {
+	VkMemoryPropertyFlags directFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+	// Small BAR heaps share the flags but are too scarce for resources
+	for (uint32_t i = 0; i < m_MemoryProperties.memoryTypeCount; i++) {
+		const VkMemoryType& memoryType = m_MemoryProperties.memoryTypes[i];
+		if ((typeFilter & (1 << i)) && (memoryType.propertyFlags & directFlags) == directFlags && m_MemoryProperties.memoryHeaps[memoryType.heapIndex].size > DIRECT_UPLOAD_MIN_HEAP_SIZE) {
+			memoryTypeIndex = i;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// True if device local memory can be written by the host (resizable BAR or integrated)
+bool MemoryAllocator::SupportsDirectUpload() {
+	uint32_t memoryTypeIndex;
+	return FindDirectUploadMemoryType(UINT32_MAX, memoryTypeIndex);
+}
+
+// Allocate new memory block
+MemoryBlock* MemoryAllocator::CreateBlock(uint32_t memoryTypeIndex, VkDeviceSize size, bool dedicated) {
+	// Allocation info
+	VkMemoryAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = size;
+	allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+	// Allocate memory
+	MemoryBlock* block = new MemoryBlock();
+	if (vkAllocateMemory(m_Device->GetDevice(), &allocInfo, nullptr, &block->memory) != VK_SUCCESS) {
+		delete(block);
+		throw std::runtime_error("Failed to allocate memory block!");
+	}
+
+	// Fill in block details, whole block starts free
+	block->size = size;
+	block->memoryTypeIndex = memoryTypeIndex;
+	block->dedicated = dedicated;
+	block->freeRanges[0] = size;
+
+	// Keep host visible memory mapped for the lifetime of the block
+	if (m_MemoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+		vkMapMemory(m_Device->GetDevice(), block->memory, 0, size, 0, &block->mappedData);
+	}
+
+	AddUsage(m_HeapBlockUsage[GetHeapIndex(memoryTypeIndex)], size);
+	m_Blocks[memoryTypeIndex].push_back(block);
+	return block;
+}
+
+// Free memory block
+void MemoryAllocator::DestroyBlock(MemoryBlock* block) {
+	// Unmap and free memory
+	if (block->mappedData != nullptr) {
+		vkUnmapMemory(m_Device->GetDevice(), block->memory);
+	}
+	vkFreeMemory(m_Device->GetDevice(), block->memory, nullptr);
+	RemoveUsage(m_HeapBlockUsage[GetHeapIndex(block->memoryTypeIndex)], block->size);
+	delete(block);
+}
+
+// Sub-allocate from block
+bool MemoryAllocator::AllocateFromBlock(MemoryBlock* block, VkDeviceSize size, VkDeviceSize alignment, MemoryCategory category, Allocation& allocation) {
+	// Find first free range the aligned allocation fits in
+	for (auto it = block->freeRanges.begin(); it != block->freeRanges.end(); ++it) {
+		VkDeviceSize rangeOffset = it->first;
+		VkDeviceSize rangeEnd = it->first + it->second;
+		VkDeviceSize offset = AlignUp(rangeOffset, alignment);
+		if (offset + size > rangeEnd) {
+			continue;
+		}
+
+		// Split range around allocation
+		block->freeRanges.erase(it);
+		if (offset > rangeOffset) {
+			block->freeRanges[rangeOffset] = offset - rangeOffset;
+		}
+		if (offset + size < rangeEnd) {
+			block->freeRanges[offset + size] = rangeEnd - (offset + size);
+		}
+
+		// Update block usage and accounting
+		block->usedSize += size;
+		block->allocationCount++;
+		AddUsage(m_CategoryUsage[category], size);
+		AddUsage(m_HeapAllocationUsage[GetHeapIndex(block->memoryTypeIndex)], size);
+
+		// Fill in allocation
+		allocation.memory = block->memory;
+		allocation.offset = offset;
+		allocation.size = size;
+		allocation.memoryTypeIndex = block->memoryTypeIndex;
+		allocation.category = category;
+		allocation.mappedData = block->mappedData ? static_cast<char*>(block->mappedData) + offset : nullptr;
+		allocation.block = block;
+		return true;
+	}
+
+	return false;
+}
+
+// Preferred block size for memory type
+VkDeviceSize MemoryAllocator::GetBlockSize(uint32_t memoryTypeIndex) {
+	// Use smaller blocks on small heaps
+	VkDeviceSize heapSize = m_MemoryProperties.memoryHeaps[m_MemoryProperties.memoryTypes[memoryTypeIndex].heapIndex].size;
+	return std::min(DEFAULT_BLOCK_SIZE, heapSize / 8);
+}
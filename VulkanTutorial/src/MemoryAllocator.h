@@ -0,0 +1,108 @@
+#pragma once
+
+#include "vulkan/vulkan.h"
+
+#include <map>
+#include <vector>
+
+class Device;
+
+// Default size of sub-allocated memory blocks
+const VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+
+// Smallest device local host visible heap used for direct uploads, excludes the legacy 256 MiB BAR window
+const VkDeviceSize DIRECT_UPLOAD_MIN_HEAP_SIZE = 256ull * 1024 * 1024;
+
+// Categories allocations are accounted under
+typedef enum MemoryCategory {
+	MEMORY_CATEGORY_OTHER,
+	MEMORY_CATEGORY_VERTEX,
+	MEMORY_CATEGORY_INDEX,
+	MEMORY_CATEGORY_UNIFORM,
+	MEMORY_CATEGORY_TEXTURE,
+	MEMORY_CATEGORY_ATTACHMENT,
+	MEMORY_CATEGORY_STAGING,
+	MEMORY_CATEGORY_COUNT
+} MemoryCategory;
+
+// Current and peak bytes of a category or heap
+struct MemoryUsage {
+	VkDeviceSize current = 0;					// Bytes in use
+	VkDeviceSize peak = 0;						// Highest bytes in use so far
+	uint32_t allocationCount = 0;				// Number of live allocations
+};
+
+// Usage and budget of a memory heap
+struct HeapBudget {
+	VkDeviceSize size = 0;						// Size of heap
+	MemoryUsage blocks;							// Device memory allocated by us
+	MemoryUsage allocations;					// Bytes sub-allocated to resources
+	VkDeviceSize usage = 0;						// Process usage, from VK_EXT_memory_budget if available
+	VkDeviceSize budget = 0;					// Bytes the process can use, estimated without VK_EXT_memory_budget
+	bool deviceLocal = false;					// True if heap is device local
+};
+
+// Block of device memory which allocations are sub-allocated from
+struct MemoryBlock {
+	VkDeviceMemory memory = VK_NULL_HANDLE;		// Vulkan device memory
+	VkDeviceSize size = 0;						// Size of block in bytes
+	VkDeviceSize usedSize = 0;					// Bytes used by live allocations
+	uint32_t memoryTypeIndex = 0;				// Memory type of block
+	uint32_t allocationCount = 0;				// Number of live allocations
+	bool dedicated = false;						// True if block holds one large allocation
+	void* mappedData = nullptr;					// Persistent mapping if host visible
+	std::map<VkDeviceSize, VkDeviceSize> freeRanges;	// Free ranges (offset -> size)
+};
+
+// Region of a memory block owned by a buffer or image
+struct Allocation {
+	VkDeviceMemory memory = VK_NULL_HANDLE;		// Vulkan device memory
+	VkDeviceSize offset = 0;					// Offset into memory
+	VkDeviceSize size = 0;						// Size in bytes
+	uint32_t memoryTypeIndex = 0;				// Memory type of allocation
+	MemoryCategory category = MEMORY_CATEGORY_OTHER;	// Category allocation is accounted under
+	void* mappedData = nullptr;					// Host pointer if host visible
+	MemoryBlock* block = nullptr;				// Block allocation lives in
+};
+
+class MemoryAllocator {
+public:
+	MemoryAllocator(Device* device);		// Constructor
+	~MemoryAllocator();						// Destructor
+
+	// FUNCTIONS
+	Allocation Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, MemoryCategory category = MEMORY_CATEGORY_OTHER, VkMemoryPropertyFlags preferredProperties = 0);	// Allocate memory, creating blocks as needed
+	Allocation AllocateOfType(const VkMemoryRequirements& requirements, uint32_t memoryTypeIndex, MemoryCategory category = MEMORY_CATEGORY_OTHER);	// Allocate memory of a chosen type, creating blocks as needed
+	Allocation AllocateAliased(const std::vector<VkMemoryRequirements>& requirements, VkMemoryPropertyFlags properties, MemoryCategory category, VkMemoryPropertyFlags preferredProperties = 0);	// Allocate memory resources with non overlapping lifetimes can share
+	bool AllocateFromExistingBlocks(const VkMemoryRequirements& requirements, uint32_t memoryTypeIndex, MemoryCategory category, const MemoryBlock* excludedBlock, Allocation& allocation);	// Allocate without creating blocks
+	void Free(Allocation& allocation);		// Return allocation to its block
+	uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties, VkMemoryPropertyFlags preferredProperties = 0);	// Find appropriate memory type, with preferred properties if possible
+	bool FindDirectUploadMemoryType(uint32_t typeFilter, uint32_t& memoryTypeIndex);	// Host visible device local type on a heap big enough to hold resources, false if none
+	bool SupportsDirectUpload();			// True if device local memory can be written by the host (resizable BAR or integrated)
+	std::vector<HeapBudget> GetHeapBudgets();	// Usage and budget of every heap
+	void LogUsage();						// Print one line summary of heaps and categories
+	static const char* GetCategoryName(MemoryCategory category);	// Name of category for logging
+
+	// GETTERS
+	const std::vector<MemoryBlock*>& GetBlocks(uint32_t memoryTypeIndex) { return m_Blocks[memoryTypeIndex]; }
+	uint32_t GetMemoryTypeCount() { return m_MemoryProperties.memoryTypeCount; }
+	VkMemoryPropertyFlags GetMemoryTypeFlags(uint32_t memoryTypeIndex) { return m_MemoryProperties.memoryTypes[memoryTypeIndex].propertyFlags; }
+	const MemoryUsage& GetCategoryUsage(MemoryCategory category) { return m_CategoryUsage[category]; }
+private:
+	// VARIABLES
+	Device* m_Device;										// Vulkan device
+	VkPhysicalDeviceMemoryProperties m_MemoryProperties;	// Memory types and heaps
+	VkDeviceSize m_Granularity;								// Buffer image granularity
+	std::vector<std::vector<MemoryBlock*>> m_Blocks;		// Blocks for each memory type
+	MemoryUsage m_CategoryUsage[MEMORY_CATEGORY_COUNT];		// Usage of each category
+	std::vector<MemoryUsage> m_HeapBlockUsage;				// Block memory of each heap
+	std::vector<MemoryUsage> m_HeapAllocationUsage;			// Sub-allocated memory of each heap
+	PFN_vkGetPhysicalDeviceMemoryProperties2KHR m_GetMemoryProperties2;	// Budget query, null without VK_EXT_memory_budget
+
+	// FUNCTIONS
+	MemoryBlock* CreateBlock(uint32_t memoryTypeIndex, VkDeviceSize size, bool dedicated);	// Allocate new memory block
+	void DestroyBlock(MemoryBlock* block);													// Free memory block
+	bool AllocateFromBlock(MemoryBlock* block, VkDeviceSize size, VkDeviceSize alignment, MemoryCategory category, Allocation& allocation);	// Sub-allocate from block
+	VkDeviceSize GetBlockSize(uint32_t memoryTypeIndex);									// Preferred block size for memory type
+	uint32_t GetHeapIndex(uint32_t memoryTypeIndex) { return m_MemoryProperties.memoryTypes[memoryTypeIndex].heapIndex; }
+};
@@ -56,8 +56,17 @@ Model::Model(Device* device, CommandPool* commandPool, const char* modelPath, co
 		}
 	}
 
-	CreateVertexBuffer();
-	CreateIndexBuffer();
+	// Upload vertex and index data in one submission
+	VkCommandBuffer commandBuffer = m_CommandPool->BeginSingleTimeCommands();
+	std::vector<Buffer*> stagingBuffers;
+	CreateVertexBuffer(commandBuffer, stagingBuffers);
+	CreateIndexBuffer(commandBuffer, stagingBuffers);
+	m_CommandPool->EndSingleTimeCommands(commandBuffer);
+
+	// Delete staging buffers now copies are done
+	for (Buffer* stagingBuffer : stagingBuffers) {
+		delete(stagingBuffer);
+	}
 
 }
 
@@ -87,46 +96,46 @@ void Model::Draw(VkCommandBuffer commandBuffer){
 }
 
 // Create vertex buffer
-void Model::CreateVertexBuffer() {
+void Model::CreateVertexBuffer(VkCommandBuffer commandBuffer, std::vector<Buffer*>& stagingBuffers) {
 
 	// Get buffer size
 	VkDeviceSize bufferSize = sizeof(m_Vertices[0]) * m_Vertices.size();
 
-	// Create staging buffer
-	Buffer stagingBuffer(m_Device, bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-	// Map data
-	void* data;
-	vkMapMemory(m_Device->GetDevice(), stagingBuffer.GetBufferMemory(), 0, bufferSize, 0, &data);
-	memcpy(data, m_Vertices.data(), (size_t)bufferSize);
-	vkUnmapMemory(m_Device->GetDevice(), stagingBuffer.GetBufferMemory());
-
 	// Create vertex buffer
-	m_VertexBuffer = new Buffer(m_Device, bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, BUFFER_VERTEX);
-
-	// Copy data to vertex buffer
-	m_VertexBuffer->CopyToBuffer(m_CommandPool->GetCommandPool(), stagingBuffer.GetBuffer(), bufferSize);
+	m_VertexBuffer = CreateDeviceBuffer(commandBuffer, stagingBuffers, m_Vertices.data(), bufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, BUFFER_VERTEX);
 }
 
 // Create index buffer
-void Model::CreateIndexBuffer() {
+void Model::CreateIndexBuffer(VkCommandBuffer commandBuffer, std::vector<Buffer*>& stagingBuffers) {
 
 	// Get buffer size
 	VkDeviceSize bufferSize = sizeof(m_Indices[0]) * m_Indices.size();
 
-	// Create staging buffer
-	Buffer stagingBuffer(m_Device, bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	// Create index buffer
+	m_IndexBuffer = CreateDeviceBuffer(commandBuffer, stagingBuffers, m_Indices.data(), bufferSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, BUFFER_INDEX);
+}
 
-	// Map data
-	void* data;
-	vkMapMemory(m_Device->GetDevice(), stagingBuffer.GetBufferMemory(), 0, bufferSize, 0, &data);
-	memcpy(data, m_Indices.data(), (size_t)bufferSize);
-	vkUnmapMemory(m_Device->GetDevice(), stagingBuffer.GetBufferMemory());
+// Create device local buffer holding data
+Buffer* Model::CreateDeviceBuffer(VkCommandBuffer commandBuffer, std::vector<Buffer*>& stagingBuffers, const void* data, VkDeviceSize size, VkBufferUsageFlags usage, BufferType bufferType) {
 
-	// Create index buffer
-	m_IndexBuffer = new Buffer(m_Device, bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, BUFFER_INDEX);
+	// Write straight into device local memory when the host can map it
+	if (m_Device->GetAllocator()->SupportsDirectUpload()) {
+		Buffer* buffer = new Buffer(m_Device, size, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, bufferType);
+		buffer->Upload(data, size);
+		return buffer;
+	}
+
+	// Create staging buffer, kept until the submission finishes
+	Buffer* stagingBuffer = new Buffer(m_Device, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	stagingBuffers.push_back(stagingBuffer);
 
-	// Copy data to index buffer
-	m_IndexBuffer->CopyToBuffer(m_CommandPool->GetCommandPool(), stagingBuffer.GetBuffer(), bufferSize);
+	// Copy data to persistently mapped staging memory
+	stagingBuffer->Upload(data, size);
 
-}
\ No newline at end of file
+	// Create buffer, copyable so defragmentation can move it
+	Buffer* buffer = new Buffer(m_Device, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, bufferType);
+
+	// Record copy to buffer
+	buffer->CopyToBuffer(commandBuffer, stagingBuffer->GetBuffer(), size);
+	return buffer;
+}
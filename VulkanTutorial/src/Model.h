@@ -21,6 +21,8 @@ public:
 	// GETTERS
 	VkImageView GetTextureView() { return m_Texture->GetImage()->GetImageView(); }
 	Texture* GetTexture() { return m_Texture; }
+	Buffer* GetVertexBuffer() { return m_VertexBuffer; }
+	Buffer* GetIndexBuffer() { return m_IndexBuffer; }
 private:
 	// VARIABLES
 	Device* m_Device;				// Vulkan device
@@ -32,6 +34,7 @@ private:
 	Buffer* m_IndexBuffer;			// Vertex buffer for model
 
 	// FUNCTIONS
-	void CreateVertexBuffer();		// Create vertex buffer
-	void CreateIndexBuffer();		// Create index buffer
+	void CreateVertexBuffer(VkCommandBuffer commandBuffer, std::vector<Buffer*>& stagingBuffers);	// Create vertex buffer
+	void CreateIndexBuffer(VkCommandBuffer commandBuffer, std::vector<Buffer*>& stagingBuffers);	// Create index buffer
+	Buffer* CreateDeviceBuffer(VkCommandBuffer commandBuffer, std::vector<Buffer*>& stagingBuffers, const void* data, VkDeviceSize size, VkBufferUsageFlags usage, BufferType bufferType);	// Create device local buffer holding data
 };
\ No newline at end of file
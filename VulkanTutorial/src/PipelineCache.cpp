@@ -0,0 +1,121 @@
+#include "PipelineCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#endif
+
+// Constructor, loads cache file if it matches the device
+PipelineCache::PipelineCache(Device* device, const std::string& path) : m_Device(device), m_PipelineCache(VK_NULL_HANDLE), m_Path(path), m_Warm(false) {
+	// Previous run's data
+	std::vector<char> data = Load();
+	m_Warm = !data.empty();
+
+	// Pipeline cache creation info
+	VkPipelineCacheCreateInfo cacheInfo = {};
+	cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	cacheInfo.initialDataSize = data.size();
+	cacheInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+	// Create pipeline cache
+	if (vkCreatePipelineCache(m_Device->GetDevice(), &cacheInfo, nullptr, &m_PipelineCache) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create pipeline cache!");
+	}
+}
+
+// Destructor, saves cache
+PipelineCache::~PipelineCache() {
+	// Losing the cache only costs compile time next run
+	try {
+		Save();
+	}
+	catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+	}
+
+	vkDestroyPipelineCache(m_Device->GetDevice(), m_PipelineCache, nullptr);
+}
+
+// Write cache data to a temporary file and replace cache file with it
+void PipelineCache::Save() {
+	// Query size then data
+	size_t size = 0;
+	vkGetPipelineCacheData(m_Device->GetDevice(), m_PipelineCache, &size, nullptr);
+	std::vector<char> data(size);
+	if (size == 0 || vkGetPipelineCacheData(m_Device->GetDevice(), m_PipelineCache, &size, data.data()) != VK_SUCCESS) {
+		return;
+	}
+
+	// Write everything before replacing, a crash never leaves a partial cache file
+	std::string tempPath = m_Path + ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		file.write(data.data(), size);
+		if (!file) {
+			throw std::runtime_error("Failed to write pipeline cache " + tempPath + "!");
+		}
+	}
+
+	// Replace cache file in one step
+#ifdef _WIN32
+	bool replaced = MoveFileExA(tempPath.c_str(), m_Path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+	bool replaced = std::rename(tempPath.c_str(), m_Path.c_str()) == 0;
+#endif
+	if (!replaced) {
+		std::remove(tempPath.c_str());
+		throw std::runtime_error("Failed to replace pipeline cache " + m_Path + "!");
+	}
+}
+
+// Read cache file, empty if missing or from another device
+std::vector<char> PipelineCache::Load() {
+	// Open file
+	std::ifstream file(m_Path, std::ios::ate | std::ios::binary);
+	if (!file.is_open()) {
+		return {};
+	}
+
+	// Read all bytes of file
+	std::vector<char> data(static_cast<size_t>(file.tellg()));
+	file.seekg(0);
+	file.read(data.data(), data.size());
+	if (!file) {
+		return {};
+	}
+
+	// Data from another driver would be rejected or, worse, misread
+	if (!IsCompatible(data)) {
+		std::cout << "Pipeline cache " << m_Path << " is from another device or driver, discarding it" << std::endl;
+		return {};
+	}
+	return data;
+}
+
+// True if header matches vendor, device and cache UUID
+bool PipelineCache::IsCompatible(const std::vector<char>& data) {
+	if (data.size() < PIPELINE_CACHE_HEADER_SIZE) {
+		return false;
+	}
+
+	// Header is headerSize, headerVersion, vendorID, deviceID and pipelineCacheUUID
+	uint32_t header[4];
+	uint8_t uuid[VK_UUID_SIZE];
+	memcpy(header, data.data(), sizeof(header));
+	memcpy(uuid, data.data() + sizeof(header), VK_UUID_SIZE);
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(m_Device->GetPhysicalDevice(), &properties);
+
+	return header[0] >= PIPELINE_CACHE_HEADER_SIZE && header[0] <= data.size()
+		&& header[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+		&& header[2] == properties.vendorID
+		&& header[3] == properties.deviceID
+		&& memcmp(uuid, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "vulkan/vulkan.h"
+#include "Device.h"
+
+#include <string>
+#include <vector>
+
+// File pipeline cache is kept in between runs
+const char* const PIPELINE_CACHE_PATH = "pipeline_cache.bin";
+
+// Size of the version one header at the start of pipeline cache data
+const size_t PIPELINE_CACHE_HEADER_SIZE = 16 + VK_UUID_SIZE;
+
+// Pipeline cache kept on disk between runs
+class PipelineCache {
+public:
+	PipelineCache(Device* device, const std::string& path = PIPELINE_CACHE_PATH);	// Constructor, loads cache file if it matches the device
+	~PipelineCache();						// Destructor, saves cache
+
+	// FUNCTIONS
+	void Save();							// Write cache data to a temporary file and replace cache file with it
+
+	// GETTERS
+	VkPipelineCache GetPipelineCache() { return m_PipelineCache; }
+	bool IsWarm() { return m_Warm; }		// True if cache was loaded from disk
+private:
+	// VARIABLES
+	Device* m_Device;						// Device object
+	VkPipelineCache m_PipelineCache;		// Vulkan pipeline cache
+	std::string m_Path;						// Cache file
+	bool m_Warm;							// True if cache was loaded from disk
+
+	// FUNCTIONS
+	std::vector<char> Load();				// Read cache file, empty if missing or from another device
+	bool IsCompatible(const std::vector<char>& data);	// True if header matches vendor, device and cache UUID
+};
@@ -0,0 +1,323 @@
+#include "PipelineLibrary.h"
+
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+// FNV-1a of bytes continuing from hash
+static uint64_t HashBytes(uint64_t hash, const void* data, size_t size) {
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	for (size_t i = 0; i < size; i++) {
+		hash = (hash ^ bytes[i]) * 1099511628211ull;
+	}
+	return hash;
+}
+
+// Hash of everything but the shader module and render pass handles
+uint64_t PipelineState::Hash() const {
+	uint64_t hash = 14695981039346656037ull;
+	hash = HashBytes(hash, &vertexShaderHash, sizeof(vertexShaderHash));
+	hash = HashBytes(hash, &fragmentShaderHash, sizeof(fragmentShaderHash));
+	hash = HashBytes(hash, specialization.data(), specialization.size() * sizeof(SpecializationConstant));
+	hash = HashBytes(hash, bindings.data(), bindings.size() * sizeof(VkVertexInputBindingDescription));
+	hash = HashBytes(hash, attributes.data(), attributes.size() * sizeof(VkVertexInputAttributeDescription));
+
+	// Fixed function state
+	uint32_t fixedFunction[] = {
+		static_cast<uint32_t>(topology), static_cast<uint32_t>(polygonMode), cullMode, static_cast<uint32_t>(frontFace),
+		static_cast<uint32_t>(samples), depthTest, depthWrite, static_cast<uint32_t>(depthCompare), blend, subpass
+	};
+	hash = HashBytes(hash, fixedFunction, sizeof(fixedFunction));
+	hash = HashBytes(hash, &layout, sizeof(layout));
+	hash = HashBytes(hash, &renderPassKey, sizeof(renderPassKey));
+	return hash;
+}
+
+// Equal if compatible render passes and same state
+bool PipelineState::operator==(const PipelineState& other) const {
+	return vertexShaderHash == other.vertexShaderHash && fragmentShaderHash == other.fragmentShaderHash
+		&& specialization.size() == other.specialization.size()
+		&& memcmp(specialization.data(), other.specialization.data(), specialization.size() * sizeof(SpecializationConstant)) == 0
+		&& bindings.size() == other.bindings.size() && attributes.size() == other.attributes.size()
+		&& memcmp(bindings.data(), other.bindings.data(), bindings.size() * sizeof(VkVertexInputBindingDescription)) == 0
+		&& memcmp(attributes.data(), other.attributes.data(), attributes.size() * sizeof(VkVertexInputAttributeDescription)) == 0
+		&& topology == other.topology && polygonMode == other.polygonMode && cullMode == other.cullMode && frontFace == other.frontFace
+		&& samples == other.samples && depthTest == other.depthTest && depthWrite == other.depthWrite && depthCompare == other.depthCompare
+		&& blend == other.blend && layout == other.layout && renderPassKey == other.renderPassKey && subpass == other.subpass;
+}
+
+// Constructor
+PipelineLibrary::PipelineLibrary(Device* device, PipelineCache* pipelineCache, JobSystem* jobSystem)
+	: m_Device(device), m_PipelineCache(pipelineCache), m_JobSystem(jobSystem) {
+}
+
+// Destructor, waits for compiles and destroys pipelines
+PipelineLibrary::~PipelineLibrary() {
+	// Failed compiles have nothing to destroy
+	for (auto& entry : m_Entries) {
+		try {
+			m_JobSystem->Wait(entry.second.job);
+		}
+		catch (const std::exception&) {
+		}
+	}
+
+	for (auto& entry : m_Entries) {
+		if (entry.second.pipeline != VK_NULL_HANDLE) {
+			vkDestroyPipeline(m_Device->GetDevice(), entry.second.pipeline, nullptr);
+		}
+	}
+}
+
+// Start compiling pipelines needed soon
+void PipelineLibrary::Precompile(const std::vector<PipelineState>& states) {
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	for (const PipelineState& state : states) {
+		FindOrCompile(state);
+	}
+}
+
+// Pipeline for state, compile started on first request
+VkPipeline PipelineLibrary::GetPipeline(const PipelineState& state, PipelineMissPolicy policy, VkPipeline fallback) {
+	JobHandle job;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		Entry& entry = FindOrCompile(state);
+		if (entry.pipeline != VK_NULL_HANDLE) {
+			return entry.pipeline;
+		}
+		job = entry.job;
+	}
+
+	// Waiting rethrows a failed compile instead of skipping its draws forever
+	if (policy == PIPELINE_MISS_POLICY_BLOCK || JobSystem::IsFinished(job)) {
+		m_JobSystem->Wait(job);
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_Entries[state].pipeline;
+	}
+	return policy == PIPELINE_MISS_POLICY_FALLBACK ? fallback : VK_NULL_HANDLE;
+}
+
+// Wait for every compile started so far
+void PipelineLibrary::WaitIdle() {
+	std::vector<JobHandle> jobs;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		for (auto& entry : m_Entries) {
+			jobs.push_back(entry.second.job);
+		}
+	}
+
+	for (const JobHandle& job : jobs) {
+		m_JobSystem->Wait(job);
+	}
+}
+
+// Compiles not finished yet, any may use a render pass given so far
+std::vector<JobHandle> PipelineLibrary::GetPendingJobs() {
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	std::vector<JobHandle> jobs;
+	for (auto& entry : m_Entries) {
+		if (!JobSystem::IsFinished(entry.second.job)) {
+			jobs.push_back(entry.second.job);
+		}
+	}
+	return jobs;
+}
+
+// Compiles not finished yet
+uint32_t PipelineLibrary::GetPendingCount() {
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	uint32_t count = 0;
+	for (auto& entry : m_Entries) {
+		if (!JobSystem::IsFinished(entry.second.job)) {
+			count++;
+		}
+	}
+	return count;
+}
+
+// Entry of state, compile scheduled if new, lock held by caller
+PipelineLibrary::Entry& PipelineLibrary::FindOrCompile(const PipelineState& state) {
+	auto found = m_Entries.find(state);
+	if (found != m_Entries.end()) {
+		return found->second;
+	}
+
+	// Elements of an unordered map keep their address, so the task can fill the entry in
+	Entry& entry = m_Entries[state];
+	entry.job = m_JobSystem->Schedule([this, state, &entry]() {
+		VkPipeline pipeline = Compile(state);
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		entry.pipeline = pipeline;
+	}, {}, JOB_PRIORITY_BACKGROUND);
+	return entry;
+}
+
+// Create pipeline, runs on a worker
+VkPipeline PipelineLibrary::Compile(const PipelineState& state) {
+	// Specialization constants packed one word each, the driver folds them into the shaders
+	std::vector<VkSpecializationMapEntry> mapEntries;
+	std::vector<uint32_t> specializationData;
+	for (const SpecializationConstant& constant : state.specialization) {
+		mapEntries.push_back({ constant.id, static_cast<uint32_t>(specializationData.size() * sizeof(uint32_t)), sizeof(uint32_t) });
+		specializationData.push_back(constant.value);
+	}
+	VkSpecializationInfo specializationInfo = {};
+	specializationInfo.mapEntryCount = static_cast<uint32_t>(mapEntries.size());
+	specializationInfo.pMapEntries = mapEntries.data();
+	specializationInfo.dataSize = specializationData.size() * sizeof(uint32_t);
+	specializationInfo.pData = specializationData.data();
+
+	// Vertex shader stage creation info
+	VkPipelineShaderStageCreateInfo vertShaderStageInfo = {};
+	vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
+	vertShaderStageInfo.module = state.vertexShader;
+	vertShaderStageInfo.pName = "main";
+	vertShaderStageInfo.pSpecializationInfo = mapEntries.empty() ? nullptr : &specializationInfo;
+
+	// Fragment shader stage creation info
+	VkPipelineShaderStageCreateInfo fragShaderStageInfo = {};
+	fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	fragShaderStageInfo.module = state.fragmentShader;
+	fragShaderStageInfo.pName = "main";
+	fragShaderStageInfo.pSpecializationInfo = mapEntries.empty() ? nullptr : &specializationInfo;
+
+	// Put info into array
+	VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
+
+	// Vertex input creation info
+	VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(state.bindings.size());
+	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(state.attributes.size());
+	vertexInputInfo.pVertexBindingDescriptions = state.bindings.data();
+	vertexInputInfo.pVertexAttributeDescriptions = state.attributes.data();
+
+	// Input assembly creation info
+	VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssembly.topology = state.topology;
+	inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+	// Viewport state creation info, viewport and scissor are set while recording
+	VkPipelineViewportStateCreateInfo viewportState = {};
+	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportState.viewportCount = 1;
+	viewportState.pViewports = nullptr;
+	viewportState.scissorCount = 1;
+	viewportState.pScissors = nullptr;
+
+	// Rasterizer creation info
+	VkPipelineRasterizationStateCreateInfo rasterizer = {};
+	rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterizer.depthClampEnable = VK_FALSE;
+	rasterizer.rasterizerDiscardEnable = VK_FALSE;
+	rasterizer.polygonMode = state.polygonMode;
+	rasterizer.lineWidth = 1.0f;
+	rasterizer.cullMode = state.cullMode;
+	rasterizer.frontFace = state.frontFace;
+	rasterizer.depthBiasEnable = VK_FALSE;
+	rasterizer.depthBiasConstantFactor = 0.0f;
+	rasterizer.depthBiasClamp = 0.0f;
+	rasterizer.depthBiasSlopeFactor = 0.0f;
+
+	// Multisampling info
+	VkPipelineMultisampleStateCreateInfo multisampling = {};
+	multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisampling.sampleShadingEnable = VK_FALSE;
+	multisampling.rasterizationSamples = state.samples;
+	multisampling.minSampleShading = 1.0f;
+	multisampling.pSampleMask = nullptr;
+	multisampling.alphaToCoverageEnable = VK_FALSE;
+	multisampling.alphaToOneEnable = VK_FALSE;
+
+	// Depth stencil info
+	VkPipelineDepthStencilStateCreateInfo depthStencil = {};
+	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencil.depthTestEnable = state.depthTest ? VK_TRUE : VK_FALSE;
+	depthStencil.depthWriteEnable = state.depthWrite ? VK_TRUE : VK_FALSE;
+	depthStencil.depthCompareOp = state.depthCompare;
+	depthStencil.depthBoundsTestEnable = VK_FALSE;
+	depthStencil.minDepthBounds = 0.0f;
+	depthStencil.maxDepthBounds = 1.0f;
+	depthStencil.stencilTestEnable = VK_FALSE;
+	depthStencil.front = {};
+	depthStencil.back = {};
+
+	// Colour blending info, blending mixes by source alpha
+	VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
+	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	colorBlendAttachment.blendEnable = state.blend ? VK_TRUE : VK_FALSE;
+	colorBlendAttachment.srcColorBlendFactor = state.blend ? VK_BLEND_FACTOR_SRC_ALPHA : VK_BLEND_FACTOR_ONE;
+	colorBlendAttachment.dstColorBlendFactor = state.blend ? VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA : VK_BLEND_FACTOR_ZERO;
+	colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+	colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+	colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+	colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+
+	// Colour blending state info
+	VkPipelineColorBlendStateCreateInfo colorBlending = {};
+	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	colorBlending.logicOpEnable = VK_FALSE;
+	colorBlending.logicOp = VK_LOGIC_OP_COPY;
+	colorBlending.attachmentCount = 1;
+	colorBlending.pAttachments = &colorBlendAttachment;
+	colorBlending.blendConstants[0] = 0.0f;
+	colorBlending.blendConstants[1] = 0.0f;
+	colorBlending.blendConstants[2] = 0.0f;
+	colorBlending.blendConstants[3] = 0.0f;
+
+	// Dynamic state of pipeline, keeps it independent of the swap chain extent
+	std::array<VkDynamicState, 3> dynamicStates = {
+		VK_DYNAMIC_STATE_VIEWPORT,
+		VK_DYNAMIC_STATE_SCISSOR,
+		VK_DYNAMIC_STATE_LINE_WIDTH
+	};
+	VkPipelineDynamicStateCreateInfo dynamicState = {};
+	dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+	dynamicState.pDynamicStates = dynamicStates.data();
+
+	// Graphics pipeline creation info
+	VkGraphicsPipelineCreateInfo pipelineInfo = {};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineInfo.stageCount = 2;
+	pipelineInfo.pStages = shaderStages;
+	pipelineInfo.pVertexInputState = &vertexInputInfo;
+	pipelineInfo.pInputAssemblyState = &inputAssembly;
+	pipelineInfo.pViewportState = &viewportState;
+	pipelineInfo.pRasterizationState = &rasterizer;
+	pipelineInfo.pMultisampleState = &multisampling;
+	pipelineInfo.pDepthStencilState = &depthStencil;
+	pipelineInfo.pColorBlendState = &colorBlending;
+	pipelineInfo.pDynamicState = &dynamicState;
+	pipelineInfo.layout = state.layout;
+	pipelineInfo.renderPass = state.renderPass;
+	pipelineInfo.subpass = state.subpass;
+	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+	pipelineInfo.basePipelineIndex = -1;
+
+	// Create pipeline, timed to show the pipeline cache's effect, the cache is internally synchronised
+	VkPipeline pipeline;
+	auto startTime = std::chrono::high_resolution_clock::now();
+	if (vkCreateGraphicsPipelines(m_Device->GetDevice(), m_PipelineCache->GetPipelineCache(), 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create graphics pipeline!");
+	}
+	double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+	// One write so lines of concurrent compiles do not interleave
+	std::ostringstream message;
+	message << "Graphics pipeline " << std::hex << std::setw(16) << std::setfill('0') << state.Hash() << std::dec
+		<< " created in " << std::fixed << std::setprecision(2) << milliseconds << " ms ("
+		<< (m_PipelineCache->IsWarm() ? "warm" : "cold") << " pipeline cache)\n";
+	std::cout << message.str() << std::flush;
+
+	return pipeline;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "vulkan/vulkan.h"
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "Device.h"
+#include "JobSystem.h"
+#include "PipelineCache.h"
+
+// What GetPipeline returns while a pipeline is still compiling
+typedef enum PipelineMissPolicy {
+	PIPELINE_MISS_POLICY_SKIP,			// Null, caller skips its draws
+	PIPELINE_MISS_POLICY_FALLBACK,		// Fallback pipeline given by caller
+	PIPELINE_MISS_POLICY_BLOCK			// Wait for compile
+} PipelineMissPolicy;
+
+// Specialization constant value, GLSL bool, int, uint and float constants are all 32 bit
+struct SpecializationConstant {
+	uint32_t id;							// constant_id in GLSL
+	uint32_t value;							// Value bits, bools are 0 or 1
+};
+
+// Shader and fixed function state of a graphics pipeline, viewport, scissor and line width are dynamic
+struct PipelineState {
+	VkShaderModule vertexShader = VK_NULL_HANDLE;	// Vertex shader module, entry point main
+	VkShaderModule fragmentShader = VK_NULL_HANDLE;	// Fragment shader module, entry point main
+	uint64_t vertexShaderHash = 0;					// Content hash of vertex shader, keys the pipeline instead of the handle
+	uint64_t fragmentShaderHash = 0;				// Content hash of fragment shader, keys the pipeline instead of the handle
+	std::vector<SpecializationConstant> specialization;	// Variant constants given to both stages, ids a stage lacks are ignored
+	std::vector<VkVertexInputBindingDescription> bindings;		// Vertex buffer bindings
+	std::vector<VkVertexInputAttributeDescription> attributes;	// Vertex attributes
+	VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;	// Primitive topology
+	VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;	// Fill mode
+	VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;	// Culled faces
+	VkFrontFace frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;	// Winding of front faces
+	VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;	// Rasterization samples
+	bool depthTest = true;							// Test against depth attachment
+	bool depthWrite = true;							// Write depth attachment
+	VkCompareOp depthCompare = VK_COMPARE_OP_LESS;	// Depth test
+	bool blend = false;								// Alpha blend colour attachment
+	VkPipelineLayout layout = VK_NULL_HANDLE;		// Pipeline layout
+	VkRenderPass renderPass = VK_NULL_HANDLE;		// Render pass compiled against, kept alive until GetPendingJobs have finished
+	uint64_t renderPassKey = 0;						// Identifies render passes compatible with renderPass
+	uint32_t subpass = 0;							// Subpass index
+
+	uint64_t Hash() const;							// Hash of everything but the shader module and render pass handles
+	bool operator==(const PipelineState& other) const;	// Equal if compatible render passes and same state
+};
+
+// Create hash data for pipeline state
+namespace std {
+	template<> struct hash<PipelineState> {
+		size_t operator()(PipelineState const& state) const {
+			return static_cast<size_t>(state.Hash());
+		}
+	};
+}
+
+// Graphics pipelines by state, compiled on worker threads
+class PipelineLibrary {
+public:
+	PipelineLibrary(Device* device, PipelineCache* pipelineCache, JobSystem* jobSystem);	// Constructor
+	~PipelineLibrary();						// Destructor, waits for compiles and destroys pipelines
+
+	// FUNCTIONS
+	void Precompile(const std::vector<PipelineState>& states);	// Start compiling pipelines needed soon
+	VkPipeline GetPipeline(const PipelineState& state, PipelineMissPolicy policy, VkPipeline fallback = VK_NULL_HANDLE);	// Pipeline for state, compile started on first request
+	void WaitIdle();						// Wait for every compile started so far
+
+	// GETTERS
+	uint32_t GetPendingCount();				// Compiles not finished yet
+	std::vector<JobHandle> GetPendingJobs();	// Compiles not finished yet, any may use a render pass given so far
+private:
+	// STRUCTS
+	struct Entry {
+		VkPipeline pipeline = VK_NULL_HANDLE;	// Compiled pipeline, null while compiling
+		JobHandle job;							// Compile task
+	};
+
+	// VARIABLES
+	Device* m_Device;						// Device object
+	PipelineCache* m_PipelineCache;			// Cache compiles read and fill
+	JobSystem* m_JobSystem;					// Workers compiling pipelines
+	std::unordered_map<PipelineState, Entry> m_Entries;	// Pipelines by state
+	std::mutex m_Mutex;						// Guards entries
+
+	// FUNCTIONS
+	Entry& FindOrCompile(const PipelineState& state);	// Entry of state, compile scheduled if new, lock held by caller
+	VkPipeline Compile(const PipelineState& state);		// Create pipeline, runs on a worker
+};
@@ -0,0 +1,222 @@
+#include "QueueTimeline.h"
+#include "Device.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+// Constructor
+QueueTimeline::QueueTimeline(Device* device, VkQueue queue)
+	: m_Device(device), m_Queue(queue), m_Semaphore(VK_NULL_HANDLE), m_LastSubmittedValue(0), m_CompletedValue(0) {
+#ifdef VK_KHR_timeline_semaphore
+	if (!m_Device->IsExtensionEnabled(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME)) {
+		return;
+	}
+
+	// Extension entry points
+	m_GetSemaphoreCounterValue = (PFN_vkGetSemaphoreCounterValueKHR)vkGetDeviceProcAddr(m_Device->GetDevice(), "vkGetSemaphoreCounterValueKHR");
+	m_WaitSemaphores = (PFN_vkWaitSemaphoresKHR)vkGetDeviceProcAddr(m_Device->GetDevice(), "vkWaitSemaphoresKHR");
+	if (m_GetSemaphoreCounterValue == nullptr || m_WaitSemaphores == nullptr) {
+		return;
+	}
+
+	// Timeline semaphore starting at 0
+	VkSemaphoreTypeCreateInfoKHR typeInfo = {};
+	typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR;
+	typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+	typeInfo.initialValue = 0;
+	VkSemaphoreCreateInfo semaphoreInfo = {};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphoreInfo.pNext = &typeInfo;
+
+	// Create semaphore
+	if (vkCreateSemaphore(m_Device->GetDevice(), &semaphoreInfo, nullptr, &m_Semaphore) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create timeline semaphore!");
+	}
+#endif
+}
+
+// Destructor, waits for the queue and runs deferred destruction
+QueueTimeline::~QueueTimeline() {
+	Wait(m_LastSubmittedValue);
+	CollectGarbage();
+
+	// Destroy synchronisation objects
+	for (const PendingFence& pending : m_PendingFences) {
+		vkDestroyFence(m_Device->GetDevice(), pending.fence, nullptr);
+	}
+	for (VkFence fence : m_FreeFences) {
+		vkDestroyFence(m_Device->GetDevice(), fence, nullptr);
+	}
+	if (m_Semaphore != VK_NULL_HANDLE) {
+		vkDestroySemaphore(m_Device->GetDevice(), m_Semaphore, nullptr);
+	}
+}
+
+// Submit batch and return the value signalled when it finishes
+uint64_t QueueTimeline::Submit(const VkSubmitInfo& submitInfo) {
+	uint64_t value = m_LastSubmittedValue + 1;
+	VkSubmitInfo timelineSubmitInfo = submitInfo;
+	VkFence fence = VK_NULL_HANDLE;
+
+	// Waits on other queues, the same queue already runs in order
+	std::vector<VkSemaphore> waitSemaphores(submitInfo.pWaitSemaphores, submitInfo.pWaitSemaphores + submitInfo.waitSemaphoreCount);
+	std::vector<VkPipelineStageFlags> waitStages(submitInfo.pWaitDstStageMask, submitInfo.pWaitDstStageMask + submitInfo.waitSemaphoreCount);
+	std::vector<uint64_t> waitValues(submitInfo.waitSemaphoreCount, 0);
+	for (const TimelineWait& wait : m_PendingWaits) {
+		if (wait.timeline == this || wait.timeline->IsComplete(wait.value)) {
+			continue;
+		}
+
+		// Without timeline semaphores the handoff falls back to waiting on the CPU
+		if (m_Semaphore == VK_NULL_HANDLE || wait.timeline->m_Semaphore == VK_NULL_HANDLE) {
+			wait.timeline->Wait(wait.value);
+			continue;
+		}
+		waitSemaphores.push_back(wait.timeline->m_Semaphore);
+		waitStages.push_back(wait.stage);
+		waitValues.push_back(wait.value);
+	}
+	m_PendingWaits.clear();
+	timelineSubmitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+	timelineSubmitInfo.pWaitSemaphores = waitSemaphores.data();
+	timelineSubmitInfo.pWaitDstStageMask = waitStages.data();
+
+#ifdef VK_KHR_timeline_semaphore
+	// Signal timeline alongside the batch's own semaphores, binary semaphores ignore their values
+	std::vector<VkSemaphore> signalSemaphores(submitInfo.pSignalSemaphores, submitInfo.pSignalSemaphores + submitInfo.signalSemaphoreCount);
+	std::vector<uint64_t> signalValues(submitInfo.signalSemaphoreCount, 0);
+	VkTimelineSemaphoreSubmitInfoKHR timelineInfo = {};
+	if (m_Semaphore != VK_NULL_HANDLE) {
+		signalSemaphores.push_back(m_Semaphore);
+		signalValues.push_back(value);
+
+		timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+		timelineInfo.pNext = submitInfo.pNext;
+		timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size());
+		timelineInfo.pWaitSemaphoreValues = waitValues.data();
+		timelineInfo.signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size());
+		timelineInfo.pSignalSemaphoreValues = signalValues.data();
+
+		timelineSubmitInfo.pNext = &timelineInfo;
+		timelineSubmitInfo.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+		timelineSubmitInfo.pSignalSemaphores = signalSemaphores.data();
+	}
+#endif
+
+	// Without a timeline every submission gets a fence
+	if (m_Semaphore == VK_NULL_HANDLE) {
+		PollFences();
+		if (m_FreeFences.empty()) {
+			VkFenceCreateInfo fenceInfo = {};
+			fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+			if (vkCreateFence(m_Device->GetDevice(), &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to create fence!");
+			}
+		}
+		else {
+			fence = m_FreeFences.back();
+			m_FreeFences.pop_back();
+			vkResetFences(m_Device->GetDevice(), 1, &fence);
+		}
+	}
+
+	// Submit to queue
+	if (vkQueueSubmit(m_Queue, 1, &timelineSubmitInfo, fence) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to submit to queue!");
+	}
+
+	if (fence != VK_NULL_HANDLE) {
+		m_PendingFences.push_back({ fence, value });
+	}
+	m_LastSubmittedValue = value;
+	return value;
+}
+
+// Make next submission wait until another timeline passes value
+void QueueTimeline::AddWait(QueueTimeline* timeline, uint64_t value, VkPipelineStageFlags stage) {
+	m_PendingWaits.push_back({ timeline, value, stage });
+}
+
+// True if GPU has passed value
+bool QueueTimeline::IsComplete(uint64_t value) {
+	return value <= m_CompletedValue || value <= GetCompletedValue();
+}
+
+// Block until GPU has passed value
+void QueueTimeline::Wait(uint64_t value) {
+	if (IsComplete(value)) {
+		return;
+	}
+
+#ifdef VK_KHR_timeline_semaphore
+	if (m_Semaphore != VK_NULL_HANDLE) {
+		VkSemaphoreWaitInfoKHR waitInfo = {};
+		waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR;
+		waitInfo.semaphoreCount = 1;
+		waitInfo.pSemaphores = &m_Semaphore;
+		waitInfo.pValues = &value;
+		m_WaitSemaphores(m_Device->GetDevice(), &waitInfo, UINT64_MAX);
+		m_CompletedValue = std::max(m_CompletedValue, value);
+		return;
+	}
+#endif
+
+	// Fences of one queue may signal out of order, so wait for every submission up to value
+	std::vector<VkFence> fences;
+	for (const PendingFence& pending : m_PendingFences) {
+		if (pending.value <= value) {
+			fences.push_back(pending.fence);
+		}
+	}
+	vkWaitForFences(m_Device->GetDevice(), static_cast<uint32_t>(fences.size()), fences.data(), VK_TRUE, UINT64_MAX);
+	PollFences();
+}
+
+// Run destroy once GPU has passed value
+void QueueTimeline::DestroyAfter(uint64_t value, std::function<void()> destroy) {
+	// Nothing can reference it anymore
+	if (IsComplete(value)) {
+		destroy();
+		return;
+	}
+	m_Deferred.push_back({ value, destroy });
+}
+
+// Run deferred destruction whose value has passed
+void QueueTimeline::CollectGarbage() {
+	if (m_Deferred.empty()) {
+		return;
+	}
+
+	uint64_t completedValue = GetCompletedValue();
+	while (!m_Deferred.empty() && m_Deferred.front().value <= completedValue) {
+		// Pop before running in case destroy defers more work
+		std::function<void()> destroy = m_Deferred.front().destroy;
+		m_Deferred.pop_front();
+		destroy();
+	}
+}
+
+// Highest value GPU has passed
+uint64_t QueueTimeline::GetCompletedValue() {
+#ifdef VK_KHR_timeline_semaphore
+	if (m_Semaphore != VK_NULL_HANDLE) {
+		uint64_t value = 0;
+		m_GetSemaphoreCounterValue(m_Device->GetDevice(), m_Semaphore, &value);
+		m_CompletedValue = std::max(m_CompletedValue, value);
+		return m_CompletedValue;
+	}
+#endif
+
+	PollFences();
+	return m_CompletedValue;
+}
+
+// Retire finished fence submissions in order
+void QueueTimeline::PollFences() {
+	while (!m_PendingFences.empty() && vkGetFenceStatus(m_Device->GetDevice(), m_PendingFences.front().fence) == VK_SUCCESS) {
+		m_CompletedValue = std::max(m_CompletedValue, m_PendingFences.front().value);
+		m_FreeFences.push_back(m_PendingFences.front().fence);
+		m_PendingFences.pop_front();
+	}
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "vulkan/vulkan.h"
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <vector>
+
+class Device;
+
+// Counter of work completed on one queue, backed by a timeline semaphore or fences
+class QueueTimeline {
+public:
+	QueueTimeline(Device* device, VkQueue queue);	// Constructor
+	~QueueTimeline();								// Destructor, waits for the queue and runs deferred destruction
+
+	// FUNCTIONS
+	uint64_t Submit(const VkSubmitInfo& submitInfo);	// Submit batch and return the value signalled when it finishes
+	void AddWait(QueueTimeline* timeline, uint64_t value, VkPipelineStageFlags stage);	// Make next submission wait until another timeline passes value
+	bool IsComplete(uint64_t value);					// True if GPU has passed value
+	void Wait(uint64_t value);							// Block until GPU has passed value
+	void DestroyAfter(uint64_t value, std::function<void()> destroy);	// Run destroy once GPU has passed value
+	void CollectGarbage();								// Run deferred destruction whose value has passed
+
+	// GETTERS
+	uint64_t GetLastSubmittedValue() { return m_LastSubmittedValue; }
+	uint64_t GetCompletedValue();
+	bool IsTimelineSemaphore() { return m_Semaphore != VK_NULL_HANDLE; }
+private:
+	// STRUCTS
+	struct PendingFence {
+		VkFence fence;				// Signalled when submission finishes
+		uint64_t value;				// Value of submission
+	};
+
+	struct TimelineWait {
+		QueueTimeline* timeline;		// Timeline of other queue
+		uint64_t value;					// Value it must pass
+		VkPipelineStageFlags stage;		// Stages that wait
+	};
+
+	struct DeferredDestruction {
+		uint64_t value;					// Value GPU must pass first
+		std::function<void()> destroy;	// Destroys resources
+	};
+
+	// VARIABLES
+	Device* m_Device;						// Device object
+	VkQueue m_Queue;						// Queue submitted to
+	VkSemaphore m_Semaphore;				// Timeline semaphore, null when falling back to fences
+	uint64_t m_LastSubmittedValue;			// Value of last submission
+	uint64_t m_CompletedValue;				// Highest value known to have passed
+	std::deque<PendingFence> m_PendingFences;	// Fence fallback submissions in order
+	std::vector<VkFence> m_FreeFences;		// Fences ready for reuse
+	std::deque<DeferredDestruction> m_Deferred;	// Destruction waiting on values in order
+	std::vector<TimelineWait> m_PendingWaits;	// Waits added to next submission
+#ifdef VK_KHR_timeline_semaphore
+	PFN_vkGetSemaphoreCounterValueKHR m_GetSemaphoreCounterValue;	// Read timeline value
+	PFN_vkWaitSemaphoresKHR m_WaitSemaphores;						// Wait for timeline value
+#endif
+
+	// FUNCTIONS
+	void PollFences();						// Retire finished fence submissions in order
+};
@@ -0,0 +1,656 @@
+#include "RenderGraph.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+// Accesses that must be made available before anything else touches the image
+const VkAccessFlags WRITE_ACCESS_MASK = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+// Constructor
+RenderGraph::RenderGraph(Device* device, CommandPool* commandPool) : m_Device(device), m_CommandPool(commandPool), m_Compiled(false) {}
+
+// Destructor
+RenderGraph::~RenderGraph() {
+	// Destroy render passes and their framebuffers
+	for (Pass& pass : m_Passes) {
+		for (auto& framebuffer : pass.framebuffers) {
+			vkDestroyFramebuffer(m_Device->GetDevice(), framebuffer.second, nullptr);
+		}
+		if (pass.renderPass != VK_NULL_HANDLE) {
+			vkDestroyRenderPass(m_Device->GetDevice(), pass.renderPass, nullptr);
+		}
+	}
+
+	// Delete transient images before the memory they alias
+	for (Resource& resource : m_Resources) {
+		delete(resource.image);
+	}
+	for (AliasSlot& slot : m_AliasSlots) {
+		m_Device->GetAllocator()->Free(slot.allocation);
+	}
+}
+
+// Declare image owned by graph, alive only while passes use it
+RenderGraphResource RenderGraph::CreateImage(const std::string& name, VkExtent2D extent, VkFormat format, VkSampleCountFlagBits samples, VkImageAspectFlags aspectFlags) {
+	if (m_Compiled) {
+		throw std::logic_error("Render graph is already compiled!");
+	}
+
+	Resource resource = {};
+	resource.name = name;
+	resource.extent = extent;
+	resource.format = format;
+	resource.samples = samples;
+	resource.aspectFlags = aspectFlags;
+
+	// Clear depth to far plane and colour to opaque black
+	if (aspectFlags & VK_IMAGE_ASPECT_DEPTH_BIT) {
+		resource.clearValue.depthStencil = { 1.0f, 0 };
+	}
+	else {
+		resource.clearValue.color = { 0.0f, 0.0f, 0.0f, 1.0f };
+	}
+
+	m_Resources.push_back(resource);
+	return static_cast<RenderGraphResource>(m_Resources.size() - 1);
+}
+
+// Declare external image, contents are discarded at frame start and left in finalUsage
+RenderGraphResource RenderGraph::ImportImage(const std::string& name, VkExtent2D extent, VkFormat format, VkSampleCountFlagBits samples, VkImageAspectFlags aspectFlags, ResourceUsage finalUsage) {
+	RenderGraphResource handle = CreateImage(name, extent, format, samples, aspectFlags);
+	m_Resources[handle].imported = true;
+	m_Resources[handle].finalUsage = finalUsage;
+	return handle;
+}
+
+// Choose external image used by next Execute
+void RenderGraph::SetImportedImage(RenderGraphResource resource, VkImage image, VkImageView imageView) {
+	if (!m_Resources[resource].imported) {
+		throw std::invalid_argument("Only imported render graph images can be replaced!");
+	}
+	m_Resources[resource].vkImage = image;
+	m_Resources[resource].imageView = imageView;
+}
+
+// Add pass, contents apply if it has attachments
+uint32_t RenderGraph::AddPass(const std::string& name, std::function<void(VkCommandBuffer)> execute, VkSubpassContents contents) {
+	if (m_Compiled) {
+		throw std::logic_error("Render graph is already compiled!");
+	}
+
+	Pass pass;
+	pass.name = name;
+	pass.execute = execute;
+	pass.contents = contents;
+	m_Passes.push_back(pass);
+	return static_cast<uint32_t>(m_Passes.size() - 1);
+}
+
+// Declare pass reads image
+void RenderGraph::Read(uint32_t pass, RenderGraphResource resource, ResourceUsage usage) {
+	m_Passes[pass].accesses.push_back({ resource, usage, false });
+}
+
+// Declare pass writes image
+void RenderGraph::Write(uint32_t pass, RenderGraphResource resource, ResourceUsage usage) {
+	m_Passes[pass].accesses.push_back({ resource, usage, true });
+}
+
+// Never cull pass even if nothing reads its output
+void RenderGraph::SetSideEffect(uint32_t pass) {
+	m_Passes[pass].sideEffect = true;
+}
+
+// Limit pass's render pass to extent from origin, zero extent uses whole attachments
+void RenderGraph::SetRenderArea(uint32_t pass, VkExtent2D extent) {
+	m_Passes[pass].renderArea = extent;
+}
+
+// Cull, create render passes and images, alias memory and plan barriers
+void RenderGraph::Compile() {
+	if (m_Compiled) {
+		throw std::logic_error("Render graph is already compiled!");
+	}
+
+	CullPasses();
+	ComputeLifetimes();
+	CreateImages();
+	for (uint32_t i = 0; i < m_Passes.size(); i++) {
+		if (!m_Passes[i].culled) {
+			CreateRenderPass(m_Passes[i], i);
+		}
+	}
+	PlanBarriers();
+
+	m_Compiled = true;
+}
+
+// Record passes and barriers
+void RenderGraph::Execute(VkCommandBuffer commandBuffer) {
+	if (!m_Compiled) {
+		throw std::logic_error("Render graph must be compiled before execution!");
+	}
+
+	// Check external images were provided
+	for (Resource& resource : m_Resources) {
+		if (resource.imported && resource.firstPass >= 0 && resource.vkImage == VK_NULL_HANDLE) {
+			throw std::runtime_error("Render graph image " + resource.name + " was not set!");
+		}
+	}
+
+	for (Pass& pass : m_Passes) {
+		if (pass.culled) {
+			continue;
+		}
+
+		// Transition images for pass
+		RecordBarriers(commandBuffer, pass.barriers);
+
+		// Passes without attachments record outside a render pass
+		if (pass.renderPass == VK_NULL_HANDLE) {
+			pass.execute(commandBuffer);
+			continue;
+		}
+
+		// Clear values of attachments
+		std::vector<VkClearValue> clearValues;
+		for (RenderGraphResource attachment : pass.attachments) {
+			clearValues.push_back(m_Resources[attachment].clearValue);
+		}
+
+		// Render pass begin info
+		VkRenderPassBeginInfo renderPassInfo = {};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		renderPassInfo.renderPass = pass.renderPass;
+		renderPassInfo.framebuffer = GetFramebuffer(pass);
+		renderPassInfo.renderArea.offset = { 0, 0 };
+		renderPassInfo.renderArea.extent = (pass.renderArea.width > 0) ? pass.renderArea : m_Resources[pass.attachments[0]].extent;
+		renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+		renderPassInfo.pClearValues = clearValues.data();
+
+		// Record pass inside its render pass
+		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, pass.contents);
+		pass.execute(commandBuffer);
+		vkCmdEndRenderPass(commandBuffer);
+	}
+
+	// Leave imported images in their final usage
+	RecordBarriers(commandBuffer, m_FinalBarriers);
+}
+
+// Mark passes whose writes never reach an imported image
+void RenderGraph::CullPasses() {
+	// Imported images are read outside the graph
+	std::vector<bool> needed(m_Resources.size(), false);
+	for (size_t i = 0; i < m_Resources.size(); i++) {
+		needed[i] = m_Resources[i].imported;
+	}
+
+	// Walk back from the last pass, keeping writers of needed images
+	for (size_t i = m_Passes.size(); i-- > 0;) {
+		Pass& pass = m_Passes[i];
+		bool keep = pass.sideEffect;
+		for (const ResourceAccess& access : pass.accesses) {
+			if (access.write && needed[access.resource]) {
+				keep = true;
+			}
+		}
+		pass.culled = !keep;
+
+		// Whatever a kept pass reads is needed by earlier passes
+		if (keep) {
+			for (const ResourceAccess& access : pass.accesses) {
+				if (!access.write) {
+					needed[access.resource] = true;
+				}
+			}
+		}
+	}
+}
+
+// First and last pass of every image
+void RenderGraph::ComputeLifetimes() {
+	for (int32_t i = 0; i < static_cast<int32_t>(m_Passes.size()); i++) {
+		if (m_Passes[i].culled) {
+			continue;
+		}
+		for (const ResourceAccess& access : m_Passes[i].accesses) {
+			Resource& resource = m_Resources[access.resource];
+			if (resource.firstPass < 0) {
+				resource.firstPass = i;
+			}
+			resource.lastPass = i;
+		}
+	}
+}
+
+// Create transient images and alias their memory
+void RenderGraph::CreateImages() {
+	std::vector<RenderGraphResource> aliased;
+
+	for (RenderGraphResource i = 0; i < m_Resources.size(); i++) {
+		Resource& resource = m_Resources[i];
+		if (resource.imported || resource.firstPass < 0) {
+			continue;
+		}
+
+		// Image usage from every access
+		VkImageUsageFlags usage = 0;
+		bool attachmentOnly = true;
+		for (const Pass& pass : m_Passes) {
+			for (const ResourceAccess& access : pass.accesses) {
+				if (pass.culled || access.resource != i) {
+					continue;
+				}
+				switch (access.usage) {
+				case RESOURCE_USAGE_COLOUR_ATTACHMENT:
+				case RESOURCE_USAGE_RESOLVE_ATTACHMENT:
+					usage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+					break;
+				case RESOURCE_USAGE_DEPTH_ATTACHMENT:
+					usage |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+					break;
+				case RESOURCE_USAGE_SAMPLED:
+					usage |= VK_IMAGE_USAGE_SAMPLED_BIT;
+					break;
+				case RESOURCE_USAGE_TRANSFER_SRC:
+					usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+					break;
+				case RESOURCE_USAGE_TRANSFER_DST:
+					usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+					break;
+				default:
+					break;
+				}
+				attachmentOnly = attachmentOnly && IsAttachment(access.usage);
+			}
+		}
+
+		// Attachments living within one render pass are never stored, give them their own lazily allocated memory
+		if (attachmentOnly && resource.firstPass == resource.lastPass) {
+			resource.image = new Image(m_Device, m_CommandPool, resource.extent.width, resource.extent.height, 1, resource.samples, resource.format, VK_IMAGE_TILING_OPTIMAL, usage | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, resource.aspectFlags);
+			resource.vkImage = resource.image->GetImage();
+			resource.imageView = resource.image->GetImageView();
+			continue;
+		}
+
+		// Other images share memory with images used at different times
+		resource.image = new Image(m_Device, m_CommandPool, resource.extent.width, resource.extent.height, 1, resource.samples, resource.format, VK_IMAGE_TILING_OPTIMAL, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, resource.aspectFlags, true);
+		aliased.push_back(i);
+	}
+
+	// Place largest images first so smaller ones fill their slots
+	std::sort(aliased.begin(), aliased.end(), [this](RenderGraphResource a, RenderGraphResource b) {
+		return m_Resources[a].image->GetMemoryRequirements().size > m_Resources[b].image->GetMemoryRequirements().size;
+	});
+
+	// Greedily assign images to the first slot whose images are all dead before or born after them
+	for (RenderGraphResource i : aliased) {
+		Resource& resource = m_Resources[i];
+		uint32_t typeBits = resource.image->GetMemoryRequirements().memoryTypeBits;
+		for (size_t slot = 0; slot <= m_AliasSlots.size() && resource.aliasSlot < 0; slot++) {
+			if (slot == m_AliasSlots.size()) {
+				m_AliasSlots.push_back(AliasSlot());
+			}
+
+			bool fits = true;
+			for (RenderGraphResource other : m_AliasSlots[slot].resources) {
+				const Resource& otherResource = m_Resources[other];
+				bool overlaps = resource.firstPass <= otherResource.lastPass && otherResource.firstPass <= resource.lastPass;
+				if (overlaps || (typeBits & otherResource.image->GetMemoryRequirements().memoryTypeBits) == 0) {
+					fits = false;
+					break;
+				}
+			}
+			if (fits) {
+				m_AliasSlots[slot].resources.push_back(i);
+				resource.aliasSlot = static_cast<int32_t>(slot);
+			}
+		}
+	}
+
+	// Allocate each slot once and bind its images
+	for (AliasSlot& slot : m_AliasSlots) {
+		std::sort(slot.resources.begin(), slot.resources.end(), [this](RenderGraphResource a, RenderGraphResource b) {
+			return m_Resources[a].firstPass < m_Resources[b].firstPass;
+		});
+
+		std::vector<VkMemoryRequirements> requirements;
+		for (RenderGraphResource i : slot.resources) {
+			requirements.push_back(m_Resources[i].image->GetMemoryRequirements());
+		}
+		slot.allocation = m_Device->GetAllocator()->AllocateAliased(requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MEMORY_CATEGORY_ATTACHMENT);
+
+		for (RenderGraphResource i : slot.resources) {
+			m_Resources[i].image->BindMemory(slot.allocation);
+			m_Resources[i].vkImage = m_Resources[i].image->GetImage();
+			m_Resources[i].imageView = m_Resources[i].image->GetImageView();
+		}
+	}
+}
+
+// Build render pass from attachment accesses
+void RenderGraph::CreateRenderPass(Pass& pass, uint32_t passIndex) {
+	std::vector<VkAttachmentDescription> descriptions;
+	std::vector<VkAttachmentReference> colourRefs;
+	std::vector<VkAttachmentReference> resolveRefs;
+	VkAttachmentReference depthRef = {};
+	bool hasDepth = false;
+
+	// Compatibility ignores load and store operations and layouts, FNV-1a of the rest
+	uint64_t key = 14695981039346656037ull;
+
+	for (const ResourceAccess& access : pass.accesses) {
+		if (!IsAttachment(access.usage)) {
+			continue;
+		}
+		const Resource& resource = m_Resources[access.resource];
+		VkImageLayout layout = GetUsageState(access.usage, access.write).layout;
+
+		// First writer clears, resolves overwrite everything, later passes load
+		VkAttachmentDescription description = {};
+		description.format = resource.format;
+		description.samples = resource.samples;
+		if (access.usage == RESOURCE_USAGE_RESOLVE_ATTACHMENT) {
+			description.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		}
+		else if (access.write && resource.firstPass == static_cast<int32_t>(passIndex)) {
+			description.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		}
+		else {
+			description.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+		}
+
+		// Store only if something after this pass reads the image
+		bool stored = resource.imported || resource.lastPass > static_cast<int32_t>(passIndex);
+		description.storeOp = stored ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		description.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		description.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+
+		// Barriers outside the render pass perform every layout transition
+		description.initialLayout = layout;
+		description.finalLayout = layout;
+
+		// Attachment reference
+		VkAttachmentReference reference = {};
+		reference.attachment = static_cast<uint32_t>(descriptions.size());
+		reference.layout = layout;
+		if (access.usage == RESOURCE_USAGE_DEPTH_ATTACHMENT) {
+			depthRef = reference;
+			hasDepth = true;
+		}
+		else if (access.usage == RESOURCE_USAGE_RESOLVE_ATTACHMENT) {
+			resolveRefs.push_back(reference);
+		}
+		else {
+			colourRefs.push_back(reference);
+		}
+
+		descriptions.push_back(description);
+		pass.attachments.push_back(access.resource);
+
+		uint32_t compatibility[] = { static_cast<uint32_t>(description.format), static_cast<uint32_t>(description.samples), static_cast<uint32_t>(access.usage) };
+		for (uint32_t value : compatibility) {
+			key = (key ^ value) * 1099511628211ull;
+		}
+	}
+	pass.renderPassKey = key;
+
+	// Pass without attachments records outside a render pass
+	if (descriptions.empty()) {
+		return;
+	}
+
+	// Each colour attachment resolves into the resolve attachment declared in the same position
+	if (!resolveRefs.empty() && resolveRefs.size() != colourRefs.size()) {
+		throw std::runtime_error("Render graph pass " + pass.name + " needs one resolve attachment per colour attachment!");
+	}
+
+	// Subpass references
+	VkSubpassDescription subpass = {};
+	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpass.colorAttachmentCount = static_cast<uint32_t>(colourRefs.size());
+	subpass.pColorAttachments = colourRefs.data();
+	subpass.pResolveAttachments = resolveRefs.empty() ? nullptr : resolveRefs.data();
+	subpass.pDepthStencilAttachment = hasDepth ? &depthRef : nullptr;
+
+	// Render pass creation info
+	VkRenderPassCreateInfo renderPassInfo = {};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	renderPassInfo.attachmentCount = static_cast<uint32_t>(descriptions.size());
+	renderPassInfo.pAttachments = descriptions.data();
+	renderPassInfo.subpassCount = 1;
+	renderPassInfo.pSubpasses = &subpass;
+
+	// Create render pass
+	if (vkCreateRenderPass(m_Device->GetDevice(), &renderPassInfo, nullptr, &pass.renderPass) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create render pass!");
+	}
+}
+
+// Barriers needed before every pass
+void RenderGraph::PlanBarriers() {
+	// Starting state of every image
+	std::vector<ResourceState> states(m_Resources.size());
+	for (size_t i = 0; i < m_Resources.size(); i++) {
+		// Imported images are typically swap chain images, whose acquire semaphore is waited on at colour output
+		if (m_Resources[i].imported) {
+			states[i].stage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		}
+	}
+
+	for (int32_t passIndex = 0; passIndex < static_cast<int32_t>(m_Passes.size()); passIndex++) {
+		Pass& pass = m_Passes[passIndex];
+		if (pass.culled) {
+			continue;
+		}
+
+		// Merge every access of an image in this pass
+		std::map<RenderGraphResource, ResourceState> passStates;
+		std::map<RenderGraphResource, bool> passWrites;
+		for (const ResourceAccess& access : pass.accesses) {
+			ResourceState usageState = GetUsageState(access.usage, access.write);
+			auto found = passStates.find(access.resource);
+			if (found == passStates.end()) {
+				passStates[access.resource] = usageState;
+			}
+			else if (found->second.layout != usageState.layout) {
+				throw std::runtime_error("Render graph pass " + pass.name + " uses " + m_Resources[access.resource].name + " in two layouts!");
+			}
+			else {
+				found->second.stage |= usageState.stage;
+				found->second.access |= usageState.access;
+			}
+			passWrites[access.resource] = passWrites[access.resource] || access.write;
+		}
+
+		for (auto& passState : passStates) {
+			RenderGraphResource handle = passState.first;
+			Resource& resource = m_Resources[handle];
+			ResourceState& current = states[handle];
+			const ResourceState& next = passState.second;
+
+			// Aliased image starts after the previous image in its slot, whose accesses must finish first
+			if (passIndex == resource.firstPass && resource.aliasSlot >= 0) {
+				const std::vector<RenderGraphResource>& slotResources = m_AliasSlots[resource.aliasSlot].resources;
+				auto position = std::find(slotResources.begin(), slotResources.end(), handle);
+				if (position != slotResources.begin()) {
+					const ResourceState& previous = m_Resources[*(position - 1)].finalState;
+					current.stage = previous.stage;
+					current.access = previous.access;
+				}
+			}
+
+			// Layout change, hazard after a write, or write after a read needs a barrier
+			bool needsBarrier = current.layout != next.layout || (current.access & WRITE_ACCESS_MASK) != 0 || (passWrites[handle] && current.access != 0);
+			if (needsBarrier) {
+				pass.barriers.push_back({ handle, current, next });
+				current = next;
+			}
+			else {
+				// Reads in the same layout run without waiting on each other, a later write waits on all of them
+				current.stage |= next.stage;
+				current.access |= next.access;
+			}
+
+			if (passIndex == resource.lastPass) {
+				resource.finalState = current;
+			}
+		}
+	}
+
+	// Graph images are reused every frame, so their first barrier waits on the previous frame's last use of the same memory
+	for (RenderGraphResource i = 0; i < m_Resources.size(); i++) {
+		const Resource& resource = m_Resources[i];
+		if (resource.imported || resource.firstPass < 0) {
+			continue;
+		}
+
+		// Aliased image after the first in its slot already waits on the image before it
+		const ResourceState* previous = &resource.finalState;
+		if (resource.aliasSlot >= 0) {
+			const std::vector<RenderGraphResource>& slotResources = m_AliasSlots[resource.aliasSlot].resources;
+			if (slotResources.front() != i) {
+				continue;
+			}
+			previous = &m_Resources[slotResources.back()].finalState;
+		}
+
+		// Contents are discarded, only the execution and memory dependency is kept
+		for (BarrierPlan& barrier : m_Passes[resource.firstPass].barriers) {
+			if (barrier.resource == i) {
+				barrier.oldState.stage = previous->stage;
+				barrier.oldState.access = previous->access;
+			}
+		}
+	}
+
+	// Leave imported images ready for whoever uses them after the graph
+	for (RenderGraphResource i = 0; i < m_Resources.size(); i++) {
+		const Resource& resource = m_Resources[i];
+		if (resource.imported && resource.firstPass >= 0) {
+			m_FinalBarriers.push_back({ i, states[i], GetUsageState(resource.finalUsage, false) });
+		}
+	}
+}
+
+// Framebuffer for current attachment views
+VkFramebuffer RenderGraph::GetFramebuffer(Pass& pass) {
+	// Views of attachments this frame
+	std::vector<VkImageView> views;
+	for (RenderGraphResource attachment : pass.attachments) {
+		views.push_back(m_Resources[attachment].imageView);
+	}
+
+	// Reuse framebuffer made for the same views
+	auto found = pass.framebuffers.find(views);
+	if (found != pass.framebuffers.end()) {
+		return found->second;
+	}
+
+	// Framebuffer creation info
+	VkExtent2D extent = m_Resources[pass.attachments[0]].extent;
+	VkFramebufferCreateInfo framebufferInfo = {};
+	framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+	framebufferInfo.renderPass = pass.renderPass;
+	framebufferInfo.attachmentCount = static_cast<uint32_t>(views.size());
+	framebufferInfo.pAttachments = views.data();
+	framebufferInfo.width = extent.width;
+	framebufferInfo.height = extent.height;
+	framebufferInfo.layers = 1;
+
+	// Create framebuffer
+	VkFramebuffer framebuffer;
+	if (vkCreateFramebuffer(m_Device->GetDevice(), &framebufferInfo, nullptr, &framebuffer) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create framebuffer!");
+	}
+	pass.framebuffers[views] = framebuffer;
+	return framebuffer;
+}
+
+// Record barriers as one pipeline barrier
+void RenderGraph::RecordBarriers(VkCommandBuffer commandBuffer, const std::vector<BarrierPlan>& barriers) {
+	if (barriers.empty()) {
+		return;
+	}
+
+	std::vector<VkImageMemoryBarrier> imageBarriers;
+	VkPipelineStageFlags sourceStage = 0;
+	VkPipelineStageFlags destinationStage = 0;
+	for (const BarrierPlan& plan : barriers) {
+		const Resource& resource = m_Resources[plan.resource];
+
+		// Depth barriers must cover stencil too
+		VkImageAspectFlags aspectMask = resource.aspectFlags;
+		if ((aspectMask & VK_IMAGE_ASPECT_DEPTH_BIT) && (resource.format == VK_FORMAT_D32_SFLOAT_S8_UINT || resource.format == VK_FORMAT_D24_UNORM_S8_UINT)) {
+			aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
+		}
+
+		// Image memory barrier info
+		VkImageMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.oldLayout = plan.oldState.layout;
+		barrier.newLayout = plan.newState.layout;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = resource.vkImage;
+		barrier.subresourceRange.aspectMask = aspectMask;
+		barrier.subresourceRange.baseMipLevel = 0;
+		barrier.subresourceRange.levelCount = 1;
+		barrier.subresourceRange.baseArrayLayer = 0;
+		barrier.subresourceRange.layerCount = 1;
+		barrier.srcAccessMask = plan.oldState.access;
+		barrier.dstAccessMask = plan.newState.access;
+		imageBarriers.push_back(barrier);
+
+		sourceStage |= plan.oldState.stage;
+		destinationStage |= plan.newState.stage;
+	}
+
+	// Pipeline barrier command
+	vkCmdPipelineBarrier(commandBuffer, sourceStage, destinationStage, 0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+}
+
+// Layout, stage and access of usage
+RenderGraph::ResourceState RenderGraph::GetUsageState(ResourceUsage usage, bool write) {
+	ResourceState state;
+	switch (usage) {
+	case RESOURCE_USAGE_COLOUR_ATTACHMENT:
+	case RESOURCE_USAGE_RESOLVE_ATTACHMENT:
+		state.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		state.stage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		state.access = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | (write ? VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT : 0);
+		break;
+	case RESOURCE_USAGE_DEPTH_ATTACHMENT:
+		state.layout = write ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+		state.stage = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		state.access = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | (write ? VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT : 0);
+		break;
+	case RESOURCE_USAGE_SAMPLED:
+		state.layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		state.stage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		state.access = VK_ACCESS_SHADER_READ_BIT;
+		break;
+	case RESOURCE_USAGE_TRANSFER_SRC:
+		state.layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		state.stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		state.access = VK_ACCESS_TRANSFER_READ_BIT;
+		break;
+	case RESOURCE_USAGE_TRANSFER_DST:
+		state.layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		state.stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		state.access = VK_ACCESS_TRANSFER_WRITE_BIT;
+		break;
+	case RESOURCE_USAGE_PRESENT:
+		state.layout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		state.stage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+		state.access = 0;
+		break;
+	}
+	return state;
+}
+
+// True if usage is a render pass attachment
+bool RenderGraph::IsAttachment(ResourceUsage usage) {
+	return usage == RESOURCE_USAGE_COLOUR_ATTACHMENT || usage == RESOURCE_USAGE_DEPTH_ATTACHMENT || usage == RESOURCE_USAGE_RESOLVE_ATTACHMENT;
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "vulkan/vulkan.h"
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "CommandPool.h"
+#include "Device.h"
+#include "Image.h"
+#include "MemoryAllocator.h"
+
+// Index of an image declared in a render graph
+typedef uint32_t RenderGraphResource;
+
+// How a pass uses an image, decides layout, pipeline stage and access
+typedef enum ResourceUsage {
+	RESOURCE_USAGE_COLOUR_ATTACHMENT,
+	RESOURCE_USAGE_DEPTH_ATTACHMENT,
+	RESOURCE_USAGE_RESOLVE_ATTACHMENT,
+	RESOURCE_USAGE_SAMPLED,
+	RESOURCE_USAGE_TRANSFER_SRC,
+	RESOURCE_USAGE_TRANSFER_DST,
+	RESOURCE_USAGE_PRESENT
+} ResourceUsage;
+
+// Frame described as passes reading and writing images
+class RenderGraph {
+public:
+	RenderGraph(Device* device, CommandPool* commandPool);	// Constructor
+	~RenderGraph();											// Destructor
+
+	// FUNCTIONS
+	RenderGraphResource CreateImage(const std::string& name, VkExtent2D extent, VkFormat format, VkSampleCountFlagBits samples, VkImageAspectFlags aspectFlags);	// Declare image owned by graph, alive only while passes use it
+	RenderGraphResource ImportImage(const std::string& name, VkExtent2D extent, VkFormat format, VkSampleCountFlagBits samples, VkImageAspectFlags aspectFlags, ResourceUsage finalUsage);	// Declare external image, contents are discarded at frame start and left in finalUsage
+	void SetImportedImage(RenderGraphResource resource, VkImage image, VkImageView imageView);	// Choose external image used by next Execute
+	uint32_t AddPass(const std::string& name, std::function<void(VkCommandBuffer)> execute, VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);	// Add pass, contents apply if it has attachments
+	void Read(uint32_t pass, RenderGraphResource resource, ResourceUsage usage);	// Declare pass reads image
+	void Write(uint32_t pass, RenderGraphResource resource, ResourceUsage usage);	// Declare pass writes image
+	void SetSideEffect(uint32_t pass);		// Never cull pass even if nothing reads its output
+	void SetRenderArea(uint32_t pass, VkExtent2D extent);	// Limit pass's render pass to extent from origin, zero extent uses whole attachments
+	void Compile();							// Cull, create render passes and images, alias memory and plan barriers
+	void Execute(VkCommandBuffer commandBuffer);	// Record passes and barriers
+
+	// GETTERS
+	VkRenderPass GetRenderPass(uint32_t pass) { return m_Passes[pass].renderPass; }
+	uint64_t GetRenderPassKey(uint32_t pass) { return m_Passes[pass].renderPassKey; }	// Equal for compatible render passes, pipelines can be shared between them
+	bool IsCulled(uint32_t pass) { return m_Passes[pass].culled; }
+	VkImage GetImage(RenderGraphResource resource) { return m_Resources[resource].vkImage; }
+	VkImageView GetImageView(RenderGraphResource resource) { return m_Resources[resource].imageView; }
+private:
+	// STRUCTS
+	struct ResourceState {
+		VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;	// Image layout
+		VkPipelineStageFlags stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;	// Stages accessing image
+		VkAccessFlags access = 0;							// Memory accesses
+	};
+
+	struct Resource {
+		std::string name;						// Debug name
+		VkExtent2D extent;						// Size of image
+		VkFormat format;						// Image format
+		VkSampleCountFlagBits samples;			// MSAA samples
+		VkImageAspectFlags aspectFlags;			// View aspect
+		VkClearValue clearValue;				// Clear value when loaded by a render pass
+		bool imported = false;					// True if image is owned outside the graph
+		ResourceUsage finalUsage = RESOURCE_USAGE_PRESENT;	// State imported image is left in
+		Image* image = nullptr;					// Image created by graph for transient resources
+		VkImage vkImage = VK_NULL_HANDLE;		// Image used by Execute
+		VkImageView imageView = VK_NULL_HANDLE;	// View used by Execute
+		int32_t firstPass = -1;					// First pass using image after culling
+		int32_t lastPass = -1;					// Last pass using image after culling
+		int32_t aliasSlot = -1;					// Memory slot of transient image, -1 if not aliased
+		ResourceState finalState;				// State after its last pass
+	};
+
+	struct ResourceAccess {
+		RenderGraphResource resource;			// Image accessed
+		ResourceUsage usage;					// How it is used
+		bool write;								// True if pass writes image
+	};
+
+	struct BarrierPlan {
+		RenderGraphResource resource;			// Image to transition
+		ResourceState oldState;					// State before barrier
+		ResourceState newState;					// State after barrier
+	};
+
+	struct Pass {
+		std::string name;						// Debug name
+		std::function<void(VkCommandBuffer)> execute;	// Records pass commands
+		VkSubpassContents contents;				// Contents of render pass if pass has attachments
+		std::vector<ResourceAccess> accesses;	// Reads and writes in declaration order
+		bool sideEffect = false;				// Never culled
+		bool culled = false;					// True if results are never used
+		VkExtent2D renderArea = { 0, 0 };		// Area rendered from origin, zero for whole attachments
+		std::vector<BarrierPlan> barriers;		// Barriers recorded before pass
+		VkRenderPass renderPass = VK_NULL_HANDLE;	// Render pass built from attachments
+		uint64_t renderPassKey = 0;				// Hash of attachment formats, samples and references
+		std::vector<RenderGraphResource> attachments;	// Attachments in render pass order
+		std::map<std::vector<VkImageView>, VkFramebuffer> framebuffers;	// Framebuffers by attachment views
+	};
+
+	struct AliasSlot {
+		Allocation allocation;					// Memory shared by images in slot
+		std::vector<RenderGraphResource> resources;	// Images in order of use
+	};
+
+	// VARIABLES
+	Device* m_Device;						// Device object
+	CommandPool* m_CommandPool;				// Command pool given to images
+	std::vector<Resource> m_Resources;		// Declared images
+	std::vector<Pass> m_Passes;				// Passes in submission order
+	std::vector<AliasSlot> m_AliasSlots;	// Shared memory of transient images
+	std::vector<BarrierPlan> m_FinalBarriers;	// Barriers leaving imported images in their final usage
+	bool m_Compiled;						// True after Compile
+
+	// FUNCTIONS
+	void CullPasses();						// Mark passes whose writes never reach an imported image
+	void ComputeLifetimes();				// First and last pass of every image
+	void CreateImages();					// Create transient images and alias their memory
+	void CreateRenderPass(Pass& pass, uint32_t passIndex);	// Build render pass from attachment accesses
+	void PlanBarriers();					// Barriers needed before every pass
+	VkFramebuffer GetFramebuffer(Pass& pass);	// Framebuffer for current attachment views
+	void RecordBarriers(VkCommandBuffer commandBuffer, const std::vector<BarrierPlan>& barriers);	// Record barriers as one pipeline barrier
+	static ResourceState GetUsageState(ResourceUsage usage, bool write);	// Layout, stage and access of usage
+	static bool IsAttachment(ResourceUsage usage);	// True if usage is a render pass attachment
+};
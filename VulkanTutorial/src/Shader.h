@@ -9,6 +9,7 @@
 
 #include <glm/glm.hpp>
 #include "vulkan/vulkan.h"
+#include "ShaderLibrary.h"
 
 // Vertex struct
 struct Vertex {
@@ -58,6 +59,14 @@ namespace std {
 	};
 }
 
+// Optional features of the scene fragment shader, each value is the constant_id of its toggle
+typedef enum ShaderFeature {
+	SHADER_FEATURE_TEXTURE,					// Sample texture
+	SHADER_FEATURE_VERTEX_COLOUR,			// Multiply by vertex colour
+	SHADER_FEATURE_ALPHA_TEST,				// Discard fragments below half alpha
+	SHADER_FEATURE_COUNT
+} ShaderFeature;
+
 // MVP uniform struct
 struct UniformBufferObject {
 	alignas(16) glm::mat4 model;
@@ -68,18 +77,15 @@ struct UniformBufferObject {
 // Shader class
 class Shader {
 public:
-	Shader(VkDevice device, std::string vertpath, std::string fragpath);		// Constructor
-	~Shader();		// Destructor
+	Shader(ShaderLibrary* library, std::string vertpath, std::string fragpath);		// Constructor, acquires modules from library
+	~Shader();		// Destructor, releases modules
 
 	// Getters
 	VkShaderModule GetVertexShaderModule() { return m_VertexShaderModule; }
 	VkShaderModule GetFragmentShaderModule() { return m_FragmentShaderModule; }
 private:
-	VkDevice m_Device;							// Vulkan logical device
+	ShaderLibrary* m_Library;					// Library owning the modules
 
 	VkShaderModule m_VertexShaderModule;		// Vertex shader module
 	VkShaderModule m_FragmentShaderModule;		// Fragment shader module
-
-	static std::vector<char> ReadFile(const std::string& filename);		// Read shader code file into bytes
-	VkShaderModule CreateShaderModule(const std::vector<char>& code);	// Create shader module from bytecode
 };
\ No newline at end of file
@@ -0,0 +1,212 @@
+#include "ShaderLibrary.h"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Constructor
+ShaderLibrary::ShaderLibrary(VkDevice device) : m_Device(device) {
+}
+
+// Destructor, destroys modules still referenced
+ShaderLibrary::~ShaderLibrary() {
+	for (auto& module : m_Modules) {
+		vkDestroyShaderModule(m_Device, module.second.shaderModule, nullptr);
+	}
+}
+
+// Module for SPIR-V file, adds a reference
+VkShaderModule ShaderLibrary::Acquire(const std::string& path) {
+	MappedFile file = Map(path);
+	VkShaderModule shaderModule = VK_NULL_HANDLE;
+	try {
+		Validate(file, path);
+		uint64_t hash = Hash(file);
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		// Same SPIR-V already has a module
+		auto found = m_Modules.find(hash);
+		if (found != m_Modules.end()) {
+			found->second.references++;
+			shaderModule = found->second.shaderModule;
+		}
+		else {
+			// Descriptors and inputs for layouts, read before the file is unmapped
+			ShaderReflection reflection(file.words, file.size / sizeof(uint32_t));
+
+			// Shader module creation info, reading straight from the mapping
+			VkShaderModuleCreateInfo createInfo = {};
+			createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+			createInfo.codeSize = file.size;
+			createInfo.pCode = file.words;
+
+			// Create module
+			if (vkCreateShaderModule(m_Device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to create shader module!");
+			}
+
+			m_Modules.emplace(hash, Module{ shaderModule, 1, reflection });
+			m_Hashes[shaderModule] = hash;
+		}
+	}
+	catch (...) {
+		Unmap(file);
+		throw;
+	}
+
+	Unmap(file);
+	return shaderModule;
+}
+
+// Drop reference, module destroyed by the last one
+void ShaderLibrary::Release(VkShaderModule shaderModule) {
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	auto hash = m_Hashes.find(shaderModule);
+	if (hash == m_Hashes.end()) {
+		throw std::invalid_argument("Shader module was not acquired from this library!");
+	}
+
+	Module& module = m_Modules.at(hash->second);
+	if (--module.references == 0) {
+		vkDestroyShaderModule(m_Device, module.shaderModule, nullptr);
+		m_Modules.erase(hash->second);
+		m_Hashes.erase(hash);
+	}
+}
+
+// Interface of acquired module
+const ShaderReflection& ShaderLibrary::GetReflection(VkShaderModule shaderModule) {
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	auto hash = m_Hashes.find(shaderModule);
+	if (hash == m_Hashes.end()) {
+		throw std::invalid_argument("Shader module was not acquired from this library!");
+	}
+	return m_Modules.at(hash->second).reflection;
+}
+
+// Content hash of acquired module, stable when handles are reused
+uint64_t ShaderLibrary::GetHash(VkShaderModule shaderModule) {
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	auto hash = m_Hashes.find(shaderModule);
+	if (hash == m_Hashes.end()) {
+		throw std::invalid_argument("Shader module was not acquired from this library!");
+	}
+	return hash->second;
+}
+
+// Map file read only
+ShaderLibrary::MappedFile ShaderLibrary::Map(const std::string& path) {
+	MappedFile file;
+
+#ifdef _WIN32
+	// Open file
+	file.file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file.file == INVALID_HANDLE_VALUE) {
+		throw std::runtime_error("Failed to open shader " + path + "!");
+	}
+
+	// Get size
+	LARGE_INTEGER size;
+	GetFileSizeEx(file.file, &size);
+	file.size = static_cast<size_t>(size.QuadPart);
+
+	// Map whole file, empty files cannot be mapped and fail validation instead
+	if (file.size > 0) {
+		file.mapping = CreateFileMappingA(file.file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (file.mapping != nullptr) {
+			file.words = static_cast<const uint32_t*>(MapViewOfFile(file.mapping, FILE_MAP_READ, 0, 0, 0));
+		}
+		if (file.words == nullptr) {
+			Unmap(file);
+			throw std::runtime_error("Failed to map shader " + path + "!");
+		}
+	}
+#else
+	// Open file
+	file.file = open(path.c_str(), O_RDONLY);
+	if (file.file < 0) {
+		throw std::runtime_error("Failed to open shader " + path + "!");
+	}
+
+	// Get size
+	struct stat status;
+	fstat(file.file, &status);
+	file.size = static_cast<size_t>(status.st_size);
+
+	// Map whole file, empty files cannot be mapped and fail validation instead
+	if (file.size > 0) {
+		void* words = mmap(nullptr, file.size, PROT_READ, MAP_PRIVATE, file.file, 0);
+		if (words == MAP_FAILED) {
+			Unmap(file);
+			throw std::runtime_error("Failed to map shader " + path + "!");
+		}
+		file.words = static_cast<const uint32_t*>(words);
+	}
+#endif
+
+	return file;
+}
+
+// Unmap file from Map
+void ShaderLibrary::Unmap(MappedFile& file) {
+#ifdef _WIN32
+	if (file.words != nullptr) {
+		UnmapViewOfFile(file.words);
+	}
+	if (file.mapping != nullptr) {
+		CloseHandle(file.mapping);
+	}
+	if (file.file != nullptr && file.file != INVALID_HANDLE_VALUE) {
+		CloseHandle(file.file);
+	}
+	file.mapping = nullptr;
+	file.file = nullptr;
+#else
+	if (file.words != nullptr) {
+		munmap(const_cast<uint32_t*>(file.words), file.size);
+	}
+	if (file.file >= 0) {
+		close(file.file);
+	}
+	file.file = -1;
+#endif
+	file.words = nullptr;
+	file.size = 0;
+}
+
+// Throw if file is not a SPIR-V module
+void ShaderLibrary::Validate(const MappedFile& file, const std::string& path) {
+	// Vulkan reads code as words
+	if (file.size < SPIRV_HEADER_WORDS * sizeof(uint32_t) || file.size % sizeof(uint32_t) != 0) {
+		throw std::runtime_error("Shader " + path + " is not a whole number of SPIR-V words!");
+	}
+	if (reinterpret_cast<uintptr_t>(file.words) % alignof(uint32_t) != 0) {
+		throw std::runtime_error("Shader " + path + " is not aligned to SPIR-V words!");
+	}
+
+	// Byte swapped magic means SPIR-V of the other endianness, which Vulkan does not accept
+	if (file.words[0] != SPIRV_MAGIC) {
+		throw std::runtime_error("Shader " + path + " does not start with the SPIR-V magic number!");
+	}
+}
+
+// FNV-1a of file contents
+uint64_t ShaderLibrary::Hash(const MappedFile& file) {
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < file.size / sizeof(uint32_t); i++) {
+		hash = (hash ^ file.words[i]) * 1099511628211ull;
+	}
+	return hash;
+}
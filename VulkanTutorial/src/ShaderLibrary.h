@@ -0,0 +1,56 @@
+#pragma once
+
+#include "vulkan/vulkan.h"
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "ShaderReflection.h"
+
+// Memory mapped, reflected shader modules shared by content
+class ShaderLibrary {
+public:
+	ShaderLibrary(VkDevice device);			// Constructor
+	~ShaderLibrary();						// Destructor, destroys modules still referenced
+
+	// FUNCTIONS
+	VkShaderModule Acquire(const std::string& path);	// Module for SPIR-V file, adds a reference
+	void Release(VkShaderModule shaderModule);			// Drop reference, module destroyed by the last one
+	const ShaderReflection& GetReflection(VkShaderModule shaderModule);	// Interface of acquired module
+	uint64_t GetHash(VkShaderModule shaderModule);		// Content hash of acquired module, stable when handles are reused
+
+	// GETTERS
+	size_t GetModuleCount() { return m_Modules.size(); }
+private:
+	// STRUCTS
+	struct MappedFile {
+		const uint32_t* words = nullptr;	// File contents
+		size_t size = 0;					// Size in bytes
+#ifdef _WIN32
+		void* file = nullptr;				// File handle
+		void* mapping = nullptr;			// File mapping handle
+#else
+		int file = -1;						// File descriptor
+#endif
+	};
+
+	struct Module {
+		VkShaderModule shaderModule;		// Vulkan shader module
+		uint32_t references;				// Acquires not released yet
+		ShaderReflection reflection;		// Interface read while the file was mapped
+	};
+
+	// VARIABLES
+	VkDevice m_Device;						// Vulkan logical device
+	std::unordered_map<uint64_t, Module> m_Modules;		// Modules by content hash
+	std::unordered_map<VkShaderModule, uint64_t> m_Hashes;	// Content hash of every module
+	std::mutex m_Mutex;						// Guards modules
+
+	// FUNCTIONS
+	static MappedFile Map(const std::string& path);		// Map file read only
+	static void Unmap(MappedFile& file);				// Unmap file from Map
+	static void Validate(const MappedFile& file, const std::string& path);	// Throw if file is not a SPIR-V module
+	static uint64_t Hash(const MappedFile& file);		// FNV-1a of file contents
+};
@@ -0,0 +1,292 @@
+#include "ShaderReflection.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+// SPIR-V opcodes read by reflection
+static const uint32_t SPIRV_OP_ENTRY_POINT = 15;
+static const uint32_t SPIRV_OP_TYPE_BOOL = 20;
+static const uint32_t SPIRV_OP_TYPE_INT = 21;
+static const uint32_t SPIRV_OP_TYPE_FLOAT = 22;
+static const uint32_t SPIRV_OP_TYPE_VECTOR = 23;
+static const uint32_t SPIRV_OP_TYPE_MATRIX = 24;
+static const uint32_t SPIRV_OP_TYPE_IMAGE = 25;
+static const uint32_t SPIRV_OP_TYPE_SAMPLER = 26;
+static const uint32_t SPIRV_OP_TYPE_SAMPLED_IMAGE = 27;
+static const uint32_t SPIRV_OP_TYPE_ARRAY = 28;
+static const uint32_t SPIRV_OP_TYPE_RUNTIME_ARRAY = 29;
+static const uint32_t SPIRV_OP_TYPE_STRUCT = 30;
+static const uint32_t SPIRV_OP_TYPE_POINTER = 32;
+static const uint32_t SPIRV_OP_CONSTANT = 43;
+static const uint32_t SPIRV_OP_SPEC_CONSTANT_TRUE = 48;
+static const uint32_t SPIRV_OP_SPEC_CONSTANT_FALSE = 49;
+static const uint32_t SPIRV_OP_SPEC_CONSTANT = 50;
+static const uint32_t SPIRV_OP_VARIABLE = 59;
+static const uint32_t SPIRV_OP_DECORATE = 71;
+static const uint32_t SPIRV_OP_MEMBER_DECORATE = 72;
+
+// SPIR-V decorations read by reflection
+static const uint32_t SPIRV_DECORATION_SPEC_ID = 1;
+static const uint32_t SPIRV_DECORATION_BUFFER_BLOCK = 3;
+static const uint32_t SPIRV_DECORATION_ARRAY_STRIDE = 6;
+static const uint32_t SPIRV_DECORATION_MATRIX_STRIDE = 7;
+static const uint32_t SPIRV_DECORATION_BUILT_IN = 11;
+static const uint32_t SPIRV_DECORATION_LOCATION = 30;
+static const uint32_t SPIRV_DECORATION_BINDING = 33;
+static const uint32_t SPIRV_DECORATION_DESCRIPTOR_SET = 34;
+static const uint32_t SPIRV_DECORATION_OFFSET = 35;
+
+// SPIR-V storage classes of interface variables
+static const uint32_t SPIRV_STORAGE_UNIFORM_CONSTANT = 0;
+static const uint32_t SPIRV_STORAGE_INPUT = 1;
+static const uint32_t SPIRV_STORAGE_UNIFORM = 2;
+static const uint32_t SPIRV_STORAGE_PUSH_CONSTANT = 9;
+static const uint32_t SPIRV_STORAGE_STORAGE_BUFFER = 12;
+
+// SPIR-V image dimensions with their own descriptor types
+static const uint32_t SPIRV_DIM_BUFFER = 5;
+static const uint32_t SPIRV_DIM_SUBPASS_DATA = 6;
+
+// Constructor, parses module
+ShaderReflection::ShaderReflection(const uint32_t* code, size_t wordCount) : m_Stage(VK_SHADER_STAGE_ALL), m_PushConstantSize(0) {
+	if (wordCount < SPIRV_HEADER_WORDS || code[0] != SPIRV_MAGIC) {
+		throw std::runtime_error("Reflected code is not a SPIR-V module!");
+	}
+
+	// Variables are declared after the types and decorations they use, keep them for a second pass
+	struct Variable {
+		uint32_t id;
+		uint32_t pointerType;
+		uint32_t storageClass;
+	};
+	std::vector<Variable> variables;
+	std::vector<uint32_t> specConstants;
+
+	// Every instruction starts with its word count and opcode
+	size_t offset = SPIRV_HEADER_WORDS;
+	while (offset < wordCount) {
+		uint32_t opcode = code[offset] & 0xFFFF;
+		uint32_t length = code[offset] >> 16;
+		if (length == 0 || offset + length > wordCount) {
+			throw std::runtime_error("Reflected SPIR-V module has a truncated instruction!");
+		}
+		const uint32_t* operands = code + offset + 1;
+		uint32_t operandCount = length - 1;
+
+		switch (opcode) {
+		case SPIRV_OP_ENTRY_POINT:
+			// Execution models are numbered like the first five graphics stages, then compute
+			switch (operands[0]) {
+			case 0: m_Stage = VK_SHADER_STAGE_VERTEX_BIT; break;
+			case 1: m_Stage = VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT; break;
+			case 2: m_Stage = VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT; break;
+			case 3: m_Stage = VK_SHADER_STAGE_GEOMETRY_BIT; break;
+			case 4: m_Stage = VK_SHADER_STAGE_FRAGMENT_BIT; break;
+			case 5: m_Stage = VK_SHADER_STAGE_COMPUTE_BIT; break;
+			}
+			break;
+		case SPIRV_OP_TYPE_BOOL:
+		case SPIRV_OP_TYPE_INT:
+		case SPIRV_OP_TYPE_FLOAT:
+		case SPIRV_OP_TYPE_VECTOR:
+		case SPIRV_OP_TYPE_MATRIX:
+		case SPIRV_OP_TYPE_IMAGE:
+		case SPIRV_OP_TYPE_SAMPLER:
+		case SPIRV_OP_TYPE_SAMPLED_IMAGE:
+		case SPIRV_OP_TYPE_ARRAY:
+		case SPIRV_OP_TYPE_RUNTIME_ARRAY:
+		case SPIRV_OP_TYPE_STRUCT:
+		case SPIRV_OP_TYPE_POINTER: {
+			Type& type = m_Types[operands[0]];
+			type.opcode = opcode;
+			type.operands.assign(operands + 1, operands + operandCount);
+			break;
+		}
+		case SPIRV_OP_CONSTANT:
+			// Array lengths, wider constants keep their low word
+			if (operandCount >= 3) {
+				m_Constants[operands[1]] = operands[2];
+			}
+			break;
+		case SPIRV_OP_SPEC_CONSTANT_TRUE:
+		case SPIRV_OP_SPEC_CONSTANT_FALSE:
+		case SPIRV_OP_SPEC_CONSTANT:
+			specConstants.push_back(operands[1]);
+			break;
+		case SPIRV_OP_VARIABLE:
+			variables.push_back({ operands[1], operands[0], operands[2] });
+			break;
+		case SPIRV_OP_DECORATE: {
+			Decorations& decorations = m_Decorations[operands[0]];
+			uint32_t value = operandCount > 2 ? operands[2] : 0;
+			switch (operands[1]) {
+			case SPIRV_DECORATION_BUFFER_BLOCK: decorations.bufferBlock = true; break;
+			case SPIRV_DECORATION_ARRAY_STRIDE: decorations.arrayStride = value; break;
+			case SPIRV_DECORATION_SPEC_ID: decorations.hasSpecId = true; decorations.specId = value; break;
+			case SPIRV_DECORATION_BUILT_IN: decorations.builtIn = true; break;
+			case SPIRV_DECORATION_LOCATION: decorations.hasLocation = true; decorations.location = value; break;
+			case SPIRV_DECORATION_BINDING: decorations.binding = value; break;
+			case SPIRV_DECORATION_DESCRIPTOR_SET: decorations.set = value; break;
+			}
+			break;
+		}
+		case SPIRV_OP_MEMBER_DECORATE: {
+			Decorations& decorations = m_Decorations[operands[0]];
+			uint32_t member = operands[1];
+			uint32_t value = operandCount > 3 ? operands[3] : 0;
+			if (operands[2] == SPIRV_DECORATION_OFFSET) {
+				decorations.memberOffsets.resize(std::max<size_t>(decorations.memberOffsets.size(), member + 1), 0);
+				decorations.memberOffsets[member] = value;
+			}
+			else if (operands[2] == SPIRV_DECORATION_MATRIX_STRIDE) {
+				decorations.memberMatrixStrides.resize(std::max<size_t>(decorations.memberMatrixStrides.size(), member + 1), 0);
+				decorations.memberMatrixStrides[member] = value;
+			}
+			break;
+		}
+		}
+
+		offset += length;
+	}
+
+	// Interface variables
+	for (const Variable& variable : variables) {
+		const Decorations& decorations = m_Decorations[variable.id];
+		uint32_t typeId = m_Types[variable.pointerType].operands[1];
+
+		switch (variable.storageClass) {
+		case SPIRV_STORAGE_UNIFORM_CONSTANT:
+		case SPIRV_STORAGE_UNIFORM:
+		case SPIRV_STORAGE_STORAGE_BUFFER: {
+			ReflectedBinding binding = {};
+			binding.set = decorations.set;
+			binding.binding = decorations.binding;
+			binding.type = GetDescriptorType(typeId, variable.storageClass, binding.count);
+			m_Bindings.push_back(binding);
+			break;
+		}
+		case SPIRV_STORAGE_PUSH_CONSTANT:
+			m_PushConstantSize = std::max(m_PushConstantSize, GetSize(typeId));
+			break;
+		case SPIRV_STORAGE_INPUT:
+			// Built ins such as gl_VertexIndex have no location
+			if (m_Stage == VK_SHADER_STAGE_VERTEX_BIT && decorations.hasLocation && !decorations.builtIn) {
+				m_Inputs.push_back({ decorations.location, GetInputFormat(typeId) });
+			}
+			break;
+		}
+	}
+
+	// Specialization constants, ones without SpecId cannot be set by pipelines
+	for (uint32_t id : specConstants) {
+		const Decorations& decorations = m_Decorations[id];
+		if (decorations.hasSpecId) {
+			m_SpecializationConstants.push_back(decorations.specId);
+		}
+	}
+
+	// Parsing state is not needed anymore
+	m_Types.clear();
+	m_Constants.clear();
+	m_Decorations.clear();
+
+	std::sort(m_Bindings.begin(), m_Bindings.end(), [](const ReflectedBinding& a, const ReflectedBinding& b) {
+		return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+	});
+	std::sort(m_Inputs.begin(), m_Inputs.end(), [](const ReflectedInput& a, const ReflectedInput& b) {
+		return a.location < b.location;
+	});
+	std::sort(m_SpecializationConstants.begin(), m_SpecializationConstants.end());
+}
+
+// True if module declares specialization constant id
+bool ShaderReflection::HasSpecializationConstant(uint32_t id) const {
+	return std::binary_search(m_SpecializationConstants.begin(), m_SpecializationConstants.end(), id);
+}
+
+// Descriptor type and array size of variable type
+VkDescriptorType ShaderReflection::GetDescriptorType(uint32_t typeId, uint32_t storageClass, uint32_t& count) {
+	// Arrays of descriptors, runtime arrays are sized by the layout
+	count = 1;
+	const Type* type = &m_Types[typeId];
+	while (type->opcode == SPIRV_OP_TYPE_ARRAY || type->opcode == SPIRV_OP_TYPE_RUNTIME_ARRAY) {
+		count = type->opcode == SPIRV_OP_TYPE_ARRAY ? count * m_Constants[type->operands[1]] : 0;
+		typeId = type->operands[0];
+		type = &m_Types[typeId];
+	}
+
+	switch (type->opcode) {
+	case SPIRV_OP_TYPE_SAMPLED_IMAGE:
+		return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	case SPIRV_OP_TYPE_SAMPLER:
+		return VK_DESCRIPTOR_TYPE_SAMPLER;
+	case SPIRV_OP_TYPE_IMAGE: {
+		// Sampled is 1 for images used with a sampler and 2 for storage images
+		uint32_t dim = type->operands[1];
+		bool storage = type->operands[5] == 2;
+		if (dim == SPIRV_DIM_SUBPASS_DATA) {
+			return VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+		}
+		if (dim == SPIRV_DIM_BUFFER) {
+			return storage ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+		}
+		return storage ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+	}
+	case SPIRV_OP_TYPE_STRUCT:
+		// Before SPIR-V 1.3 storage buffers are uniform blocks decorated BufferBlock
+		if (storageClass == SPIRV_STORAGE_STORAGE_BUFFER || m_Decorations[typeId].bufferBlock) {
+			return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		}
+		return VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	}
+
+	throw std::runtime_error("Reflected SPIR-V module has a descriptor of unknown type!");
+}
+
+// Vertex format of input type
+VkFormat ShaderReflection::GetInputFormat(uint32_t typeId) {
+	const Type& type = m_Types[typeId];
+	uint32_t components = 1;
+	const Type* component = &type;
+	if (type.opcode == SPIRV_OP_TYPE_VECTOR) {
+		components = type.operands[1];
+		component = &m_Types[type.operands[0]];
+	}
+
+	// Float, signed or unsigned int component, then component count
+	static const VkFormat formats[3][4] = {
+		{ VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT },
+		{ VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT },
+		{ VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT }
+	};
+	if (components < 1 || components > 4 || (component->opcode != SPIRV_OP_TYPE_FLOAT && component->opcode != SPIRV_OP_TYPE_INT)) {
+		return VK_FORMAT_UNDEFINED;
+	}
+	uint32_t kind = component->opcode == SPIRV_OP_TYPE_FLOAT ? 0 : (component->operands[1] ? 1 : 2);
+	return formats[kind][components - 1];
+}
+
+// Bytes of type in an explicitly laid out block
+uint32_t ShaderReflection::GetSize(uint32_t typeId, uint32_t matrixStride) {
+	const Type& type = m_Types[typeId];
+
+	switch (type.opcode) {
+	case SPIRV_OP_TYPE_BOOL: return 4;
+	case SPIRV_OP_TYPE_INT:
+	case SPIRV_OP_TYPE_FLOAT: return type.operands[0] / 8;
+	case SPIRV_OP_TYPE_VECTOR: return type.operands[1] * GetSize(type.operands[0]);
+	case SPIRV_OP_TYPE_MATRIX: return type.operands[1] * (matrixStride != 0 ? matrixStride : GetSize(type.operands[0]));
+	case SPIRV_OP_TYPE_ARRAY: return m_Constants[type.operands[1]] * m_Decorations[typeId].arrayStride;
+	case SPIRV_OP_TYPE_STRUCT: {
+		// Block ends after the member reaching furthest
+		const Decorations& decorations = m_Decorations[typeId];
+		uint32_t size = 0;
+		for (size_t i = 0; i < type.operands.size() && i < decorations.memberOffsets.size(); i++) {
+			uint32_t memberMatrixStride = i < decorations.memberMatrixStrides.size() ? decorations.memberMatrixStrides[i] : 0;
+			size = std::max(size, decorations.memberOffsets[i] + GetSize(type.operands[i], memberMatrixStride));
+		}
+		return size;
+	}
+	}
+	return 0;
+}
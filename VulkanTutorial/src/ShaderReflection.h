@@ -0,0 +1,77 @@
+#pragma once
+
+#include "vulkan/vulkan.h"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// SPIR-V magic number, first word of every module
+const uint32_t SPIRV_MAGIC = 0x07230203;
+
+// Words in the SPIR-V header before the first instruction
+const size_t SPIRV_HEADER_WORDS = 5;
+
+// Descriptor used by a shader
+struct ReflectedBinding {
+	uint32_t set;							// Descriptor set index
+	uint32_t binding;						// Binding in set
+	VkDescriptorType type;					// Descriptor type
+	uint32_t count;							// Array size, 0 for a runtime sized array
+};
+
+// Vertex shader input
+struct ReflectedInput {
+	uint32_t location;						// Input location
+	VkFormat format;						// Format of one location, 32 bit components
+};
+
+// Interface of a SPIR-V module read from its instructions
+class ShaderReflection {
+public:
+	ShaderReflection(const uint32_t* code, size_t wordCount);	// Constructor, parses module
+
+	// GETTERS
+	VkShaderStageFlagBits GetStage() const { return m_Stage; }
+	const std::vector<ReflectedBinding>& GetBindings() const { return m_Bindings; }
+	uint32_t GetPushConstantSize() const { return m_PushConstantSize; }	// Bytes of push constant block, 0 if none
+	const std::vector<ReflectedInput>& GetInputs() const { return m_Inputs; }	// Vertex inputs, empty for other stages
+	const std::vector<uint32_t>& GetSpecializationConstants() const { return m_SpecializationConstants; }	// Ids of specialization constants
+	bool HasSpecializationConstant(uint32_t id) const;	// True if module declares specialization constant id
+private:
+	// STRUCTS
+	struct Type {
+		uint32_t opcode = 0;				// Instruction declaring type
+		std::vector<uint32_t> operands;		// Operands after result id
+	};
+
+	struct Decorations {
+		bool hasLocation = false;			// Has Location
+		bool builtIn = false;				// Has BuiltIn
+		bool hasSpecId = false;				// Has SpecId
+		uint32_t specId = 0;				// SpecId
+		bool bufferBlock = false;			// Has BufferBlock
+		uint32_t set = 0;					// DescriptorSet
+		uint32_t binding = 0;				// Binding
+		uint32_t location = 0;				// Location
+		uint32_t arrayStride = 0;			// ArrayStride
+		std::vector<uint32_t> memberOffsets;		// Offset of every struct member
+		std::vector<uint32_t> memberMatrixStrides;	// MatrixStride of every struct member
+	};
+
+	// VARIABLES
+	VkShaderStageFlagBits m_Stage;			// Stage of entry point
+	std::vector<ReflectedBinding> m_Bindings;	// Descriptors in set and binding order
+	uint32_t m_PushConstantSize;			// Bytes of push constant block
+	std::vector<ReflectedInput> m_Inputs;	// Vertex inputs in location order
+	std::vector<uint32_t> m_SpecializationConstants;	// Specialization constant ids in order
+
+	std::unordered_map<uint32_t, Type> m_Types;				// Types by id, parsing only
+	std::unordered_map<uint32_t, uint32_t> m_Constants;		// Integer constants by id, parsing only
+	std::unordered_map<uint32_t, Decorations> m_Decorations;	// Decorations by id, parsing only
+
+	// FUNCTIONS
+	VkDescriptorType GetDescriptorType(uint32_t typeId, uint32_t storageClass, uint32_t& count);	// Descriptor type and array size of variable type
+	VkFormat GetInputFormat(uint32_t typeId);		// Vertex format of input type
+	uint32_t GetSize(uint32_t typeId, uint32_t matrixStride = 0);	// Bytes of type in an explicitly laid out block
+};
@@ -26,11 +26,8 @@ Texture::Texture(Device* device, CommandPool* commandPool, const char* path)
 	// Create staging buffer
 	Buffer stagingBuffer(m_Device, imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
 	
-	// Map data to staging buffer
-	void* data;
-	vkMapMemory(m_Device->GetDevice(), stagingBuffer.GetBufferMemory(), 0, imageSize, 0, &data);
-	memcpy(data, pixels, static_cast<size_t>(imageSize));
-	vkUnmapMemory(m_Device->GetDevice(), stagingBuffer.GetBufferMemory());
+	// Copy data to persistently mapped staging memory
+	memcpy(stagingBuffer.GetMappedData(), pixels, static_cast<size_t>(imageSize));
 
 	// Clean up pixel array
 	stbi_image_free(pixels);
@@ -41,13 +38,18 @@ Texture::Texture(Device* device, CommandPool* commandPool, const char* path)
 	// Create image
 	m_Image = new Image(m_Device, commandPool, static_cast<uint32_t>(width), static_cast<uint32_t>(height), mipLevels, VK_SAMPLE_COUNT_1_BIT, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
 	
+	// Record upload into one submission
+	VkCommandBuffer commandBuffer = commandPool->BeginSingleTimeCommands();
+
 	// Transition to new layout
-	m_Image->TransitionImageLayout(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevels);
-	m_Image->CopyBufferToImage(stagingBuffer.GetBuffer(), static_cast<uint32_t>(width), static_cast<uint32_t>(height));
-	//m_Image->TransitionImageLayout(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, mipLevels);
+	m_Image->TransitionImageLayout(commandBuffer, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevels);
+	m_Image->CopyBufferToImage(commandBuffer, stagingBuffer.GetBuffer(), static_cast<uint32_t>(width), static_cast<uint32_t>(height));
 	
 	// Generate mipmaps for image
-	m_Image->GenerateMipmaps();
+	m_Image->GenerateMipmaps(commandBuffer);
+
+	// Submit and wait before staging buffer is destroyed
+	commandPool->EndSingleTimeCommands(commandBuffer);
 
 }
 
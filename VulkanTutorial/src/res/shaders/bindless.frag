@@ -0,0 +1,34 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_EXT_nonuniform_qualifier : enable
+
+layout(location = 0) in vec3 fragColour;
+layout(location = 1) in vec2 fragTexCoord;
+
+// Every texture, selected per draw
+layout(set = 1, binding = 0) uniform sampler2D textures[];
+
+layout(push_constant) uniform DrawData {
+	uint textureIndex;
+} draw;
+
+// Feature toggles set per pipeline, disabled paths are removed by the driver
+layout(constant_id = 0) const bool USE_TEXTURE = true;
+layout(constant_id = 1) const bool USE_VERTEX_COLOUR = false;
+layout(constant_id = 2) const bool ALPHA_TEST = false;
+
+layout(location = 0) out vec4 outColour;
+
+void main() {
+	vec4 colour = vec4(1.0);
+	if (USE_TEXTURE) {
+		colour = texture(textures[nonuniformEXT(draw.textureIndex)], fragTexCoord);
+	}
+	if (USE_VERTEX_COLOUR) {
+		colour.rgb *= fragColour;
+	}
+	if (ALPHA_TEST && colour.a < 0.5) {
+		discard;
+	}
+	outColour = colour;
+}
\ No newline at end of file
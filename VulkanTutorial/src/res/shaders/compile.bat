@@ -1,3 +1,4 @@
 C:\VulkanSDK\1.1.121.2\Bin32\glslc.exe test.vert -o vert.spv
 C:\VulkanSDK\1.1.121.2\Bin32\glslc.exe test.frag -o frag.spv
+C:\VulkanSDK\1.1.121.2\Bin32\glslc.exe bindless.frag -o bindless_frag.spv
 pause
\ No newline at end of file
@@ -6,8 +6,23 @@ layout(location = 1) in vec2 fragTexCoord;
 
 layout(binding = 1) uniform sampler2D texSampler;
 
+// Feature toggles set per pipeline, disabled paths are removed by the driver
+layout(constant_id = 0) const bool USE_TEXTURE = true;
+layout(constant_id = 1) const bool USE_VERTEX_COLOUR = false;
+layout(constant_id = 2) const bool ALPHA_TEST = false;
+
 layout(location = 0) out vec4 outColour;
 
 void main() {
-	outColour = texture(texSampler, fragTexCoord);
+	vec4 colour = vec4(1.0);
+	if (USE_TEXTURE) {
+		colour = texture(texSampler, fragTexCoord);
+	}
+	if (USE_VERTEX_COLOUR) {
+		colour.rgb *= fragColour;
+	}
+	if (ALPHA_TEST && colour.a < 0.5) {
+		discard;
+	}
+	outColour = colour;
 }
\ No newline at end of file